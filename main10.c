@@ -27,10 +27,66 @@
  * following commands :
  * ACTIVATE : validates sending MSISDN as a voice caller
  * SINGLE   : gives single position result 
- * MULTI    : gives 5 positions with 5 min intervals
+ * MULTI    : gives 5 positions with 4 min intervals, "MULTI count interval" e.g. "MULTI 10 60" for 10 positions every 60 sec
  * GUARD    : enables GUARD MODE - notifies when GPS position changes over SMS
  * HTTP     : will send continously positions to your HTTP server using HTTP GET method with parameters : time,longtitude,latitude
- * STOP     : disables GUARD MODE or HTTP MODE if active
+ *            every 2 minutes or every N seconds when sent as "HTTP N"
+ * STOP     : disables MULTI, GUARD MODE or HTTP MODE if active - checked during every wait, takes effect within seconds
+ * SCHED    : SCHED n hhmm days action - scheduled report n (1-8) at local time hhmm on days 1=Monday...7=Sunday
+ *            (0 = every day), action 1 = SINGLE, 2 = MULTI, "SCHED n OFF" clears it, "SCHED" lists schedule
+ *            reports are sent to number stored by ACTIVATE
+ * ALLOW    : "ALLOW number" adds number to whitelist ( up to 3 numbers beside the one stored by ACTIVATE )
+ * DENY     : "DENY number" removes number from whitelist
+ *            only whitelisted numbers can control the tracker, until first ACTIVATE any number can
+ *            ACTIVATE, ALLOW, DENY and SET are accepted only from number stored by ACTIVATE
+ * SET      : "SET parameter value" changes configuration stored in EEPROM, "SET" lists it
+ *            GUARD meters, GUARDINT / MULTI / HTTP seconds, COUNT of MULTI positions, PIN, APN, USER, PWD, URL
+ *            IGNITION 1 / 2 starts MULTI / HTTP tracking when engine runs ( car battery above 13.5V ),
+ *            IGNOFF seconds of engine off stop it, AUTOGUARD 1 arms GUARD MODE after engine stopped
+ *            MAname current of energy accounting state in 0.1mA, e.g. "SET MAGNSS 320"
+ * ENERGY   : lists minutes and estimated mAh spent in every state ( SIM7000 awake / sleep / flight mode,
+ *            GNSS, IP bearer, SMS sending ) since "ENERGY RESET", kept in EEPROM across resets
+ * TTFF     : lists GNSS searches of COLD / WARM start and HOT ( GNSS running ) by time to fix in buckets
+ *            <16, <32 ... <512, 512+ seconds, timeouts and average satellites used, "TTFF RESET" clears it,
+ *            kept in EEPROM across resets
+ * TRACE    : lists last AT commands newest first with class of response ( N = not read, O = OK, E = ERROR,
+ *            D = data ) and milliseconds to first response character, "TRACE RESET" clears it after listing
+ *            only in builds with ATTRACE 1
+ * STATS    : lists uptime, reset cause, GNSS fixes / searches with average and last time to first fix,
+ *            SMS accepted / sent and retries, HTTP 2xx / posts and bearer retries, last network search time
+ *            and searches, UART overruns, SRAM of static variables and lowest free SRAM ( painted at start ),
+ *            "STATS RESET" clears counters after listing
+ * voice call from whitelisted number is rejected ( free for the caller ) and SINGLE position is sent back
+ * ACC      : check PC1 pin battery voltage from CAR BATTERY ( must use voltage divider resistors 10kOhm/47kOhm )
+ *            with MIN / MAX / AVG of background samples taken every 10 sec since last ACC
+ *            crossing of WEAK / DISCONNECTED / OVERLOADED levels is notified by SMS to number stored by ACTIVATE
+ *            ( and posted in HTTP mode ), disconnected car battery also sends SINGLE position
+ * ALARM    : LOW level on INT1 / PD3 ( ATMEGA PIN #5 ) from car alarm sends alarm SMS to number stored by ACTIVATE
+ *            and MULTI positions, GNSS is started while alarm SMS is sent
+ *
+ * with COMBINEDACK the SINGLE/MULTI acknowledge SMS is sent only when GNSS has no fix within 30 sec,
+ * otherwise first position is the acknowledge, following MULTI positions are packed into one SMS
+ *
+ * when GNSS cannot fix in MULTI or HTTP mode ( tunnel, parking structure ) position is estimated
+ * by dead reckoning from speed and course of last good fix and flagged as ESTIMATED in the report
+ *
+ * with SMSPDU all SMS are sent in PDU mode packed to GSM 7-bit alphabet, longer reports are split
+ * to concatenated SMS ( up to 4 parts ) and delivery reports +CDS are counted
+ *
+ * with SHORTLOC position link is sent as short geohash.org/<geohash> URL, geohash precision
+ * follows HDOP of the fix, packed MULTI positions are sent as "hhmmss geohash"
+ *
+ * SMSPDU, SHORTLOC, ALARMINPUT and CARBATTALERTS are disabled by default to keep flash and stack margin
+ * of ATMEGA328P, code of disabled option is removed by linker - check avr-size and FREE of STATS after enabling
+ *
+ * with SMSINBOX incoming SMS are stored and notified by +CMTI, unread SMS are listed by AT+CMGL
+ * when tracker is ready and only processed ones are deleted - commands are not lost during GNSS fix
+ *
+ * power profile NORMAL / SAVER / CRITICAL is selected from AT+CBC voltage ( and weak car battery ), SAVER and CRITICAL
+ * report less often and search GNSS shorter, CRITICAL ends HTTP MODE, last known position is sent before supply dies
+ *
+ * every SMS waits for +CMGS confirmation from network, rejected SMS is sent again with growing backoff
+ * and then kept in RAM queue which is sent with next SMS or before sleep
  * ----------------------------------------------------------------------------------------------
  */
 
@@ -43,8 +99,12 @@
 #include <avr/sleep.h>
 #include <avr/wdt.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <avr/power.h>
 #include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <util/atomic.h>
 
 
 #define UART_NO_DATA 0x0100
@@ -53,13 +113,196 @@
 // for 1MHz : -U lfuse:w:0x62:m     on ATMEGA328P
 #define F_CPU 1000000UL
 
-// EEPROM address to store phonenumber for messages
+// EEPROM address to store phonenumber for messages - first entry of whitelist, WHITESLOTS entries of 20 bytes
 #define EEADDR 0       
+#define WHITESLOTS 4
+// numbers are compared by last WHITEDIGITS digits, so +420123456789, 00420123456789 and 123456789 are the same
+#define WHITEDIGITS 9
+// EEPROM address of reporting schedule - SCHEDSLOTS entries of 4 bytes each
+#define EESCHEDADDR 96
+#define SCHEDSLOTS 8
+// EEPROM address of runtime configuration block and its layout version
+#define EECONFADDR 128
+#define CONFVERSION 4
+// "SET PIN" is verified on SIM only when it has at least this many PIN attempts left
+#define PINMINRETRIES 3
+// EEPROM address of energy accounting totals
+#define EEENERGYADDR 272
+// EEPROM address of GNSS acquisition histogram
+#define EEGNSSADDR 320
  
 #define BAUD 9600
 // formula for 1MHz clock and U2X0 = 1 double UART speed 
 #define MYUBBR ((F_CPU / (BAUD * 8L)) - 1)
 
+// TIMER1 compare value for 1 second tick of timebase - 1MHz clock divided by prescaler 64
+#define TIMEBASE_TOP ((F_CPU / 64UL) - 1)
+
+// DEAD RECKONING - max number of seconds the last good fix may be projected forward
+// and minimum speed [km/h] below which the vehicle is treated as standing still (GNSS speed noise)
+// while estimate is possible GNSS search of a report ends after DRATTEMPTS polls ( 15 sec each )
+#define DRMAXSEC  600
+#define DRATTEMPTS 2
+#define DRMINSPEED 3
+#define DRMAXDIST  100000L     // meters - longer projection is useless and would overflow integer math
+
+// SOFT RTC - minimum seconds between two GNSS synchronizations to measure clock drift
+// and max drift correction in ppm ( internal RC oscillator may be several percent off )
+#define RTCMINDRIFT  1800
+#define RTCMAXDRIFT  100000L
+
+// SCHEDULED REPORTS - local time zone of schedule entries in minutes east of UTC
+// and number of seconds before scheduled minute to wake up SIM7000 and GNSS
+#define SCHEDZONE  60
+#define SCHEDLEAD  120
+
+// NETWORK CHECK - seconds of idle sleep after which SIM7000 is woken up to check 2G coverage,
+// supply voltage and network time
+#define NETCHECK   900
+
+// PERIODIC MODES - default number of MULTI positions and report intervals in seconds
+// MULTI count and interval and HTTP interval can be given in SMS : "MULTI 10 60", "HTTP 60"
+#define MULTICOUNT     5
+#define MULTIMAX       250
+#define MULTIINTERVAL  240
+#define HTTPINTERVAL   120
+#define GUARDINTERVAL  60
+#define GUARDDISTANCE  300       // meters of position change which trigger GUARD ALERT
+#define MININTERVAL    30
+#define MAXINTERVAL    3600
+
+// COMBINED ACKNOWLEDGE - when enabled SINGLE/MULTI acknowledge SMS is sent only if there is no GNSS fix
+// after ACKATTEMPTS polls ( 15 sec each ), otherwise first position is the acknowledge itself
+// fix not older than CACHEDFIXSEC seconds is reported at once, following MULTI positions are packed
+// into one SMS of up to PACKSIZE characters
+#define COMBINEDACK    1
+#define ACKATTEMPTS    2
+#define CACHEDFIXSEC   120
+#define PACKSIZE       280
+#define PACKTEXT       130
+#define PACKLINE       30
+
+// PDU MODE SMS - when enabled SMS are sent in PDU mode with GSM 7-bit packing, long ones are split
+// into up to SMSMAXPARTS concatenated parts, longer text goes on in next message of up to SMSMAXPARTS parts,
+// delivery reports +CDS are requested for all SMS
+#define SMSPDU         0
+#define SMSMAXPARTS    4
+#define SMSFRAGS       16
+
+// OUTBOUND SMS - every SMS waits for +CMGS confirmation, it is sent again with growing backoff and
+// if still rejected it is queued in RAM and sent together with next SMS or before sleep
+#define SMSRETRIES     3
+#define SMSBACKOFF     5
+#define SMSTIMEOUT     60
+// packed MULTI positions are kept right behind queued SMS in the same buffer - they are rarely large
+// together, PACKROOM bytes are left to queue packed positions with number and battery voltage
+#define SMSQUEUESIZE   330
+#define PACKROOM       48
+
+// SHORT LOCATION LINK - position is sent as geohash after short base URL instead of full Google Maps link,
+// geohash length ( precision ) is chosen from HDOP of the fix
+#define SHORTLOC       0
+#define GEOHASHMAX     9
+
+// SMS INBOX MODE - incoming SMS are stored in SIM7000 and notified by +CMTI, they are read by AT+CMGL
+// when firmware is ready and only processed ones are deleted, so SMS received during GNSS fix or sending are not lost
+#define SMSINBOX       1
+#define INBOXLINES     60
+
+// ALARM INPUT - car alarm output connected to INT1 / PD3 ( active LOW ) is checked in every main loop pass,
+// input is debounced by TIMER0 ticks, alarm SMS goes to number stored by ACTIVATE followed by MULTI positions
+#define ALARMINPUT     0
+#define ALARMTICK      ((F_CPU / 64UL / 100UL) - 1)      // TIMER0 compare value for 10ms tick
+#define ALARMDEBOUNCE  5                                 // input must be stable for 5 ticks = 50ms
+
+// CAR BATTERY - voltage divider 10kOhm/47kOhm on ADC1 / PC1 ( ATMEGA PIN #24 ), sampled by ADC interrupt
+// background sample is 16x oversampled ( 12-bit ) every ADCPERIOD seconds from timebase,
+// on-demand reading is 256x oversampled ( 14-bit ) in ADC noise reduction sleep
+#define ADC_PIN        1
+#define VREF_VOLTAGE   3300UL                            // VREF for ADC as UNSIGNED LONG INTEGER
+#define VFACTOR        5645UL                            // proportion between V on ADC and V before divider * 1000
+#define VDIODE         670                               // [mV] drop on diode protecting ATMEGA from negative voltage
+#define ADCPERIOD      10
+#define ADCBACKGROUND  16
+#define ADCPRECISE     256
+
+// CAR BATTERY ALERTS - background samples are compared with levels [mV], new level must last CARBATTDWELL seconds,
+// it is left only after crossing its threshold by CARBATTHYST, the same alert is not repeated within CARBATTREPEAT seconds
+// disconnected battery may mean theft - position is reported at once
+#define CARBATTALERTS      0
+#define CARBATTUNDER_LVL   10000                         // Car battery discharged [mV] real value 
+#define CARBATTDISC_LVL    7000                          // Car battery disconnected [mV] real value
+#define CARBATTOVER_LVL    14800                         // Car battery overloaded [mV] real value
+#define CARBATTHYST        300
+#define CARBATTDWELL       60
+#define CARBATTREPEAT      3600
+#define CARBATTOK          0                             // states of car battery
+#define CARBATTWEAK        1
+#define CARBATTDISCONNECTED 2
+#define CARBATTOVERLOADED  3
+
+// IGNITION - alternator charging voltage means engine is running, tracking ( IGNITION 1 = MULTI, 2 = HTTP )
+// starts when it lasts IGNITIONON seconds and stops when engine is off for IGNOFF seconds from configuration
+// with AUTOGUARD 1 GUARD MODE is armed after engine stopped
+#define IGNITION_LVL       13500                         // Car battery charged by alternator [mV]
+#define IGNITIONHYST       300
+#define IGNITIONON         20
+#define IGNITIONOFF        300
+
+// POWER PROFILES - supply voltage from AT+CBC [mV] selects NORMAL, SAVER or CRITICAL profile with hysteresis,
+// weak car battery selects at least SAVER, SAVER and CRITICAL double and quadruple report intervals and cut
+// GNSS search time ( GPSATTEMPTS polls of 15 sec ), CRITICAL ends HTTP MODE as GPRS needs most power
+// below POWERLASTGASP last known position is sent once to number stored by ACTIVATE before supply dies
+#define POWERSAVER_LVL     3700
+#define POWERCRITICAL_LVL  3500
+#define POWERLASTGASP      3400
+#define POWERHYST          50
+#define POWERNORMAL        0
+#define POWERSAVER         1
+#define POWERCRITICAL      2
+#define GPSATTEMPTS        20
+
+// ENERGY ACCOUNTING - states of SIM7000 ( one of AWAKE, SLEEP, FLIGHT ) and consumers on top of it,
+// default currents in 0.1mA can be changed by "SET MAname value", totals are saved to EEPROM every ENERGYSAVE seconds
+#define ENERGYSTATES       6
+#define E_AWAKE            0
+#define E_SLEEP            1
+#define E_FLIGHT           2
+#define E_GNSS             3
+#define E_BEARER           4
+#define E_SMS              5
+#define ENERGYSAVE         3600
+
+// STATISTICS - counters since reset for fleet tuning, listed by STATS and posted once in HTTP mode after STATS
+// free SRAM between static variables and stack is painted with STACKCANARY at start, lowest free SRAM
+// is the part still painted - it is worst case of stack depth since start or "STATS RESET"
+#define STATSITEMS         17
+#define STACKCANARY        0xC5
+
+// GNSS ACQUISITION - every search of readgpsinfo is logged by start mode to histogram of time to fix
+// ( buckets below 16, 32 ... 512 seconds, 512 and above ) or to timeout, kept in EEPROM and listed by TTFF
+// start after power on is COLD or WARM, search with GNSS already running is HOT
+// last fix younger than GNSSWARMSEC seconds allows warm start instead of cold start - GPS ephemeris
+// stays valid for 2 to 4 hours, 0 = always cold start
+#define GNSSMODES          3
+#define GNSSCOLD           0
+#define GNSSWARM           1
+#define GNSSHOT            2
+#define GNSSBUCKETS        8
+#define GNSSTIMEOUT        7
+#define GNSSWARMSEC        7200
+
+// AT TRACE - when enabled last TRACESIZE AT commands are kept in RAM ring with class of response
+// ( N = not read, O = OK, E = ERROR, D = data line only ) and milliseconds to first response character,
+// response which was not read is timed until next command, ring is listed by TRACE
+// diagnostic option - it takes ~60 bytes of SRAM and is compiled in only when set to 1
+#define ATTRACE            0
+#define TRACESIZE          12
+#define TRACENONE          0
+#define TRACEOK            1
+#define TRACEERROR         2
+#define TRACEDATA          3
+
 
 // SIM and GSM related commands
 const char AT[] PROGMEM = { "AT\r" }; 
@@ -75,14 +318,31 @@ const char PIN_MUST_BE_ENTERED[] PROGMEM = {"+CPIN: SIM PIN"};
 
 const char SHOW_PIN[] PROGMEM = {"AT+CPIN?\r"};
 const char ECHO_OFF[] PROGMEM = {"ATE0\r"};
-const char ENTER_PIN[] PROGMEM = {"AT+CPIN=\"1111\"\r"};
+const char ENTER_PIN[] PROGMEM = {"AT+CPIN=\""};         // PIN from configuration follows
+const char VERIFY_PIN[] PROGMEM = {"AT+CPWD=\"SC\",\""};  // PIN of unlocked SIM is verified by changing it to itself
+const char QUOTECOMMA[] PROGMEM = {"\",\""};             // between quoted AT command parameters
+const char SHOW_RETRIES[] PROGMEM = {"AT+SPIC\r"};       // remaining PIN1, PUK1, PIN2, PUK2 attempts
+const char ISSPIC[] PROGMEM = {"+SPIC:"};
+const char QUOTECR[] PROGMEM = {"\"\r"};                 // end of quoted AT command parameter
 const char CFGRIPIN[] PROGMEM = {"AT+CFGRI=1\r"};
 
 const char SMS1[] PROGMEM = {"AT+CMGF=1\r"};                 // select txt format of SMS
 const char SMS2[] PROGMEM = {"AT+CMGS=\""};                    // begin of sending SMS in text format
 const char DELSMS[] PROGMEM = {"AT+CMGD=4\r"};    // delete all stored SMS just in case
-const char SHOWSMS[] PROGMEM = {"AT+CNMI=1,2,0,0,0\r"};      // display automatically SMS when arrives
+const char SHOWSMS[] PROGMEM = {"AT+CNMI=1,2,0,1,0\r"};      // display automatically SMS when arrives and delivery reports +CDS
 const char ISSMS[] PROGMEM = {"CMT:"};                         // beginning of mobile terminated SMS identification
+const char SMSPDU0[] PROGMEM = {"AT+CMGF=0\r"};               // select PDU format of SMS
+const char SMSPDU1[] PROGMEM = {"AT+CMGS="};                   // begin of sending SMS in PDU format - length of TPDU follows
+const char SMSPARAM[] PROGMEM = {"AT+CSMP=49,167,0,0\r"};     // text mode SMS with delivery report request, validity 24 hours
+const char ISDELIVERY[] PROGMEM = {"+CDS:"};                   // SMS delivery report
+const char SHOWSMSINBOX[] PROGMEM = {"AT+CNMI=1,1,0,1,0\r"}; // store incoming SMS and notify index by +CMTI, delivery reports +CDS
+const char ISINBOX[] PROGMEM = {"+CMTI:"};                     // new SMS stored in inbox
+const char LISTSMS[] PROGMEM = {"AT+CMGL=\"REC UNREAD\",1\r"}; // list unread SMS without changing their status
+const char ISLIST[] PROGMEM = {"+CMGL:"};                      // header of listed SMS, text is on next line
+const char DELSMSINDEX[] PROGMEM = {"AT+CMGD="};               // delete one SMS - index follows
+const char DELSMSREAD[] PROGMEM = {"AT+CMGD=1,3\r"};          // delete read and sent SMS, unread commands are kept
+const char ISERROR[] PROGMEM = { "ERROR" };
+const char ISCMGS[] PROGMEM = {"+CMGS:"};                      // SMS accepted by network - message reference follows
 
 // SMS commands to be interpreted
 const char ISMULTI[] PROGMEM = {"MULTI"};                      // MULTI option gives 5 continous measurements
@@ -91,16 +351,46 @@ const char ISACTIVATE[] PROGMEM = {"ACTIVATE"};                // ACTIVATE activ
 const char ISGUARD[] PROGMEM = {"GUARD"};                      // GUARD mode to automatically alert of GPS position change 
 const char ISSTOP[] PROGMEM = {"STOP"};                        // STOP GUARD & HTTP mode 
 const char ISHTTP[] PROGMEM = {"HTTP"};                        // HTTP mode activation to store data using HTTP GET with parameters 
+const char ISSCHED[] PROGMEM = {"SCHED"};                      // SCHED n hhmm days action - set scheduled report entry
 
 
 const char COMMANDACK[] PROGMEM = {"COMMAND ACCEPTED\n"};               // Acknowledge that the SMS command was accepted
 const char COMMANDSINGLEACK[] PROGMEM = {"SINGLE MEASUREMENT IN PROGRESS... PLEASE WAIT 7-8 MINUTES BEFORE NEXT COMMAND\n"};         // Acknowledge that the SINGLE command was accepted
-const char COMMANDMULTIACK[] PROGMEM = {"MULTIPLE MEASUREMENTS IN PROGRESS.. PLEASE WAIT 25 MINUTES BEFORE NEXT COMMAND\n"};          // Acknowledge that the MULTI command was accepted
+const char COMMANDMULTIACK[] PROGMEM = {"MULTIPLE MEASUREMENTS IN PROGRESS.. PLEASE WAIT FOR ALL POSITIONS BEFORE NEXT COMMAND\n"};          // Acknowledge that the MULTI command was accepted
 const char ACTIVATED[] PROGMEM =  {"ACTIVATED CALLS FROM "};            // Ack activated sending number as allowed to call 
 const char GUARD[] PROGMEM =      {"GUARD MODE ACTIVATED.. PLEASE WAIT 5 MINUTES BEFORE NEXT COMMAND\n"};            // Confirmation of guard mode activated 
 const char HTTP[] PROGMEM =      {"HTTP  MODE ACTIVATED.. PLEASE WAIT 5 MINUTES BEFORE NEXT COMMAND\n"};            // Confirmation of HTTP mode activated 
 const char ALERT[] PROGMEM =      {"ALERT, POSITION CHANGED TO :  "};   // Alert, that guard detected position change
 const char STOP[] PROGMEM =       {"MODE STOPPED"};               // Guard & HTTP mode deactivated
+const char SCHEDULE[] PROGMEM =   {"SCHEDULE :"};                 // listing of scheduled reports
+const char SCHEDOFF[] PROGMEM =   {"OFF"};                        // SCHED n OFF - clears schedule entry
+const char ISALLOW[] PROGMEM = {"ALLOW"};                      // ALLOW number - add number to whitelist
+const char ISDENY[] PROGMEM = {"DENY"};                        // DENY number - remove number from whitelist
+const char WHITELIST[] PROGMEM =  {"WHITELIST :"};                // listing of whitelist
+const char ISSET[] PROGMEM = {"SET"};                          // SET parameter value - change configuration
+const char CONFIG[] PROGMEM =     {"CONFIG :"};                   // listing of configuration
+
+// default configuration written to EEPROM when there is no valid one - put your settings here
+const char CONFPIN[] PROGMEM = {"1111"};                       // SIM card PIN
+const char CONFAPN[] PROGMEM = {"internet"};                   // mobile operator APN name
+const char CONFUSER[] PROGMEM = {""};                          // mobile operator APN USERNAME if any
+const char CONFPWD[] PROGMEM = {""};                           // mobile operator APN PASSWORD if any
+const char CONFURL[] PROGMEM = {"myserver.com/update"};        // this is exact url of your HTTP server
+
+// names of configuration parameters in SET command and listing
+const char SETGUARD[] PROGMEM = {"GUARD"};
+const char SETGUARDINT[] PROGMEM = {"GUARDINT"};
+const char SETCOUNT[] PROGMEM = {"COUNT"};
+const char SETMULTI[] PROGMEM = {"MULTI"};
+const char SETHTTP[] PROGMEM = {"HTTP"};
+const char SETIGNITION[] PROGMEM = {"IGNITION"};
+const char SETIGNOFF[] PROGMEM = {"IGNOFF"};
+const char SETAUTOGUARD[] PROGMEM = {"AUTOGUARD"};
+const char SETPIN[] PROGMEM = {"PIN"};
+const char SETAPN[] PROGMEM = {"APN"};
+const char SETUSER[] PROGMEM = {"USER"};
+const char SETPWD[] PROGMEM = {"PWD"};
+const char SETURL[] PROGMEM = {"URL"};
 
 const char CRLF[] PROGMEM = {"\"\n\r"};
 
@@ -125,14 +415,93 @@ const char SAVECNF[] PROGMEM = { "AT&W\r" };
 // Disable SIM7000 LED for further reduction of power consumption
 const char DISABLELED[] PROGMEM = { "AT+CNETLIGHT=0\r" };
 
+// Network time - enable NITZ time update of SIM7000 RTC and read it
+const char ENABLENITZ[] PROGMEM = { "AT+CLTS=1\r" };
+const char READCLOCK[] PROGMEM = { "AT+CCLK?\r" };
+const char ISCLOCK[] PROGMEM = { "+CCLK: \"" };
+
+// Incoming voice call - caller number is shown by +CLIP after RING, call is rejected and position is sent
+const char ENABLECLIP[] PROGMEM = { "AT+CLIP=1\r" };
+const char ISRING[] PROGMEM = { "RING" };
+const char ISCLIP[] PROGMEM = { "+CLIP:" };
+const char HANGUP[] PROGMEM = { "ATH\r" };
+const char ALARM[] PROGMEM =      {"THE CAR ALARM HAS BEEN TRIGGERED!\n"};          // alarm input notification
+const char ISENERGY[] PROGMEM = {"ENERGY"};                    // ENERGY lists time and charge per state, "ENERGY RESET" clears it
+const char ISRESET[] PROGMEM = {"RESET"};
+const char ENERGY[] PROGMEM =     {"ENERGY [min mAh] :"};         // listing of energy accounting
+const char ENERGYTOTAL[] PROGMEM = {"\nTOTAL "};
+const char ENAWAKE[] PROGMEM = {"AWAKE"};
+const char ENSLEEP[] PROGMEM = {"SLEEP"};
+const char ENFLIGHT[] PROGMEM = {"FLIGHT"};
+const char ENGNSS[] PROGMEM = {"GNSS"};
+const char ENBEARER[] PROGMEM = {"BEARER"};
+const char ENSMS[] PROGMEM = {"SMS"};
+const char * const ENERGYNAMES[ENERGYSTATES] PROGMEM = { ENAWAKE, ENSLEEP, ENFLIGHT, ENGNSS, ENBEARER, ENSMS };
+// default currents [0.1mA] - SIM7000 awake on network, CSCLK sleep, flight mode, GNSS, open bearer and SMS on top of awake
+// ATMEGA at 1MHz never sleeps in main loop - its 0.5mA is fixed baseline included in AWAKE, SLEEP and FLIGHT
+const uint16_t ENERGYCURRENT[ENERGYSTATES] PROGMEM = { 155, 17, 13, 320, 600, 1500 };
+const char SETMA[] PROGMEM = {"MA"};
+const char ISTTFF[] PROGMEM = {"TTFF"};                        // TTFF lists GNSS acquisition histogram, "TTFF RESET" clears it
+const char TTFF[] PROGMEM =       {"GNSS FIXES BY TIME [s] :"};   // listing of GNSS acquisition histogram
+const char TTFFCOLD[] PROGMEM = {"\nCOLD"};
+const char TTFFWARM[] PROGMEM = {"\nWARM"};
+const char TTFFHOT[] PROGMEM = {"\nHOT"};
+const char * const GNSSMODENAMES[GNSSMODES] PROGMEM = { TTFFCOLD, TTFFWARM, TTFFHOT };
+const char TTFFTIMEOUT[] PROGMEM = {" TIMEOUT="};
+const char TTFFSAT[] PROGMEM = {" SAT "};                        // average satellites used at fix
+#if ATTRACE
+const char ISTRACE[] PROGMEM = {"TRACE"};                      // TRACE lists last AT commands newest first, "TRACE RESET" clears them after listing
+const char TRACE[] PROGMEM =      {"AT TRACE [ms] :"};            // listing of AT trace
+const char TRACECLASSES[] PROGMEM = {"NOED"};                    // letters of response classes
+#endif
+const char ISSTATS[] PROGMEM = {"STATS"};                      // STATS lists counters since reset, "STATS RESET" clears them
+const char STATS[] PROGMEM =      {"STATS :"};                    // listing of statistics
+const char STUP[] PROGMEM = {"\nUP "};                           // uptime [s]
+const char STRST[] PROGMEM = {" RST "};                          // reset cause - MCUSR bits
+const char STGNSS[] PROGMEM = {"\nGNSS "};                       // fixes / searches
+const char STSLASH[] PROGMEM = {"/"};
+const char STTTFF[] PROGMEM = {" TTFF "};                        // average time to first fix [s]
+const char STLAST[] PROGMEM = {" LAST "};                        // last time to first fix [s]
+const char STSMS[] PROGMEM = {"\nSMS "};                         // accepted / sent
+const char STRETRY[] PROGMEM = {" RETRY "};
+const char STHTTP[] PROGMEM = {"\nHTTP "};                       // HTTP status 2xx / posts, RETRY of IP bearer
+const char STREG[] PROGMEM = {"\nREG "};                         // last network search [s]
+const char STSEARCH[] PROGMEM = {" SEARCH "};                    // network searches
+const char STUART[] PROGMEM = {"\nUART "};                       // UART overruns
+const char STRAM[] PROGMEM = {" RAM "};                          // static variables in SRAM [bytes]
+const char STFREE[] PROGMEM = {" FREE "};                        // lowest free SRAM [bytes]
+const char * const STATSNAMES[STATSITEMS] PROGMEM = { STUP, STRST, STGNSS, STSLASH, STTTFF, STLAST, STSMS, STSLASH, STRETRY,
+                                                      STHTTP, STSLASH, STRETRY, STREG, STSEARCH, STUART, STRAM, STFREE };
+const char ISACC[] PROGMEM = {"ACC"};                          // checking CAR BATTERY voltage via ADC on PIN
+const char CARBATTREAD[] PROGMEM =  {"Car Battery voltage reading [V] = "};    // Car battery reading
+const char CARBATTFINE[] PROGMEM =  {"CAR BATTERY IS OK\n"};                      // battery back in normal range
+const char CARBATTOVER[] PROGMEM =  {"CAR BATTERY IS OVERLOADED\n"};            // battery over treshold
+const char CARBATTUNDER[] PROGMEM = {"CAR BATTERY IS WEAK\n"};                    // battery is discharged
+const char CARBATTDISC[] PROGMEM =  {"CAR BATTERY IS DISCONNECTED\n"};            // Car battery is disconnected
+const char LASTGASP[] PROGMEM = {"BATTERY EMPTY - LAST KNOWN POSITION :  "};    // last report before supply dies
+const char NOFIX[] PROGMEM = {"NO GNSS FIX SINCE RESET"};                       // last gasp without any good fix
+const char IGNITIONACK[] PROGMEM = {"ENGINE STARTED - TRACKING ACTIVATED\n"};   // tracking started by ignition
+const char CARBATTMIN[] PROGMEM =   {"\nMIN "};                      // lowest background sample since last reading
+const char CARBATTMAX[] PROGMEM =   {" MAX "};                        // highest background sample since last reading
+const char CARBATTAVG[] PROGMEM =   {" AVG "};                        // average of background samples since last reading
+
+// number of days in months for SOFT RTC date calculation
+const uint8_t MONTHDAYS[] PROGMEM = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// cosine * 1024 of 0, 5, ... 90 degrees for DEAD RECKONING, values between are interpolated
+const uint16_t COSTABLE[] PROGMEM = { 1024, 1020, 1008, 989, 962, 928, 887, 839, 784, 724, 658, 587, 512, 433, 350, 265, 178, 89, 0 };
+
 // for sending SMS predefined text 
 const char GOOGLELOC1[] PROGMEM = {"\r\n http://maps.google.com/maps?q="};
 const char GOOGLELOC2[] PROGMEM = {","};
 const char GOOGLELOC3[] PROGMEM = {"\r\n"};
+const char SHORTLOC1[] PROGMEM = {"\r\n geohash.org/"};           // short base URL, geohash is appended
+const char GEOHASH32[] PROGMEM = {"0123456789bcdefghjkmnpqrstuvwxyz"};   // geohash base32 alphabet
 const char LONG[] PROGMEM = {" LONGTITUDE="};
 const char LATT[] PROGMEM = {" LATITUDE="};
 const char BATT[] PROGMEM = {"\nBATTERY[mV]="};
 const char GPSTIME[] PROGMEM = {"\nGPSTIME="};
+const char ESTIMATED[] PROGMEM = {"\nESTIMATED BY DEAD RECKONING"};
 
 // check statuses & cells
 const char CHECKBATT[] PROGMEM = {"AT+CBC\r"};           // check battery voltage 
@@ -143,16 +512,16 @@ const char GPSISFIXED[] PROGMEM = {"+CGNSINF: 1,1,"};                 // GPS in
 const char GPSINFO[] PROGMEM = {"AT+CGNSINF\r"};                    // Read GPS LAT & LONG for SMS
 const char GPSCLDSTART[] PROGMEM = {"AT+CGNSCOLD\r"};               // GPS cold restart
 const char GPSHOTSTART[] PROGMEM = {"AT+CGNSHOT\r"};                // GPS hot restart
+const char GPSWARMSTART[] PROGMEM = {"AT+CGNSWARM\r"};              // GPS warm restart
 const char GPSPWROFF[] PROGMEM = {"AT+CGNSPWR=0\r"};                // disable GPS inside SIM7000 
-const char INITLOC[] PROGMEM = {"0000000000000000000\x00"};           // to clear location at the beginning 
 
 // HTTP communication commands
 // Definition of APN used for GPRS communication
 // Please put correct APN, USERNAME and PASSWORD here appropriate for your Mobile Network provider.
 // If no password and username delete the text between < and >
-const char SAPBR2[] PROGMEM = {"AT+SAPBR=3,1,\"APN\",\"internet\"\r"};             // Put your mobile operator APN name here
-const char SAPBR3[] PROGMEM = {"AT+SAPBR=3,1,\"USER\",\"<MyUsername>\"\r"};    // Put your mobile operator APN USERNAME here if any
-const char SAPBR4[] PROGMEM = {"AT+SAPBR=3,1,\"PWD\",\"<MyPassword>\"\r"};     // Put your mobile operator APN PASSWORD here if any
+const char SAPBR2[] PROGMEM = {"AT+SAPBR=3,1,\"APN\",\""};             // mobile operator APN name from configuration follows
+const char SAPBR3[] PROGMEM = {"AT+SAPBR=3,1,\"USER\",\""};            // mobile operator APN USERNAME from configuration follows
+const char SAPBR4[] PROGMEM = {"AT+SAPBR=3,1,\"PWD\",\""};             // mobile operator APN PASSWORD from configuration follows
 
 // PDP-LTE bearer  context commands
 const char SAPBROPEN[] PROGMEM = {"AT+SAPBR=1,1\r"};      // open IP bearer
@@ -166,49 +535,448 @@ const char SAPBRSUCC[] PROGMEM = {"+SAPBR: 1,1"};           // bearer was succes
 const char HTTPINIT[] PROGMEM = { "AT+HTTPINIT\r" };
 const char HTTPPARA[] PROGMEM = { "AT+HTTPPARA=\"CID\",1\r" };
 const char HTTPURL1[] PROGMEM = { "AT+HTTPPARA=\"URL\",\"http://" };
-const char HTTPURL2[] PROGMEM = { "myserver.com/update" };       // this is exact url of your HTTP server
 const char HTTPURL3[] PROGMEM = { "&longtitude=" };
 const char HTTPURL4[] PROGMEM = { "&latitude=" };
 const char HTTPURL5[] PROGMEM = { "&time=" };
 const char HTTPURL6[] PROGMEM = { "\"\n\r" };
+const char HTTPURL7[] PROGMEM = { "&estimated=1" };     // position projected by dead reckoning, not measured
+const char HTTPURL8[] PROGMEM = { "&carbattery=" };     // car battery voltage [mV]
+const char HTTPURL9[] PROGMEM = { "&carbattalert=" };   // car battery state changed : 0 = ok, 1 = weak, 2 = disconnected, 3 = overloaded
+const char HTTPURL10[] PROGMEM = { "&mah=" };           // estimated charge used since energy accounting reset
+const char HTTPURL11[] PROGMEM = { "&stats=" };         // statistics in order of STATS listing, comma separated
+const char ISHTTPACTION[] PROGMEM = { "+HTTPACTION:" }; // result of HTTP request - method,status,length
 const char HTTPACTION[] PROGMEM = { "AT+HTTPACTION=0\r" };
 
 
 // buffers for number of phone, responses from modem
 // must fit SMS message with details
 #define BUFFER_SIZE 170
-volatile static uint8_t response[BUFFER_SIZE] = "12345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890";
-volatile static uint8_t response_pos = 0;
-volatile static uint8_t phonenumber[20] = "12345678901234567890";
-volatile static uint8_t phonenumber_pos = 0;
-volatile static uint8_t smsphonenumber[20] = "12345678901234567890";
-volatile static uint8_t smsphonenumber_pos = 0;
-volatile static uint8_t smstext[BUFFER_SIZE] = "12345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890";
-volatile static uint8_t smstext_pos = 0;
-
-
-// buffers for Google GPS API data -  longtitude & latitude data
-volatile static uint8_t latitude[20] = "00000000000000000000";
-volatile static uint8_t latitude_pos = 0;
-volatile static uint8_t longtitude[20] = "00000000000000000000";
-volatile static uint8_t longtitude_pos = 0;
-volatile static uint8_t utctime[20] = "00000000000000000000";
-volatile static uint8_t utctime_pos = 0;
-
-// buffers for SIM7000 GPS data -  longtitude & latitude data
-volatile static uint8_t latitudegps[20] = "00000000000000000000";
-volatile static uint8_t longtitudegps[20] = "00000000000000000000";
-volatile static uint8_t utctimegps[20] = "00000000000000000000";
-volatile static uint8_t latitudegpsold[20] = "00000000000000000000";
-volatile static uint8_t longtitudegpsold[20] = "00000000000000000000";
+static uint8_t response[BUFFER_SIZE];
+static uint8_t response_pos = 0;
+static uint8_t phonenumber[20];
+static uint8_t phonenumber_pos = 0;
+static uint8_t smsphonenumber[20];
+static uint8_t smsphonenumber_pos = 0;
+static uint8_t smstext[BUFFER_SIZE];
+static uint8_t smstext_pos = 0;
+
+
+// GNSS fix - fields of +CGNSINF are parsed in place and reported from here, dead reckoning writes
+// estimated position to the same place, so there is single copy of reported position
+struct gnssfix {
+  uint8_t utctime[15];           // yyyyMMddhhmmss
+  uint8_t latitude[11];          // [-90.000000,90.000000]
+  uint8_t longtitude[12];        // [-180.000000,180.000000]
+  uint8_t speed[10];             // speed over ground [km/h]
+  uint8_t course[10];            // course over ground [degrees]
+  uint8_t hdop[6];               // horizontal dilution of precision
+  uint8_t measured;              // 1 = parsed from GNSS, 0 = estimated by dead reckoning
+};
+static struct gnssfix fix = { "00000000000000", "0.000000", "0.000000", "0", "0", "0", 0 };
+static uint8_t geohash[GEOHASHMAX+1];                 // short location code of fix
+static uint8_t shortloc = SHORTLOC;                   // option enabled
 
 // other buffers
-volatile static uint8_t buf[40];  // buffer to copy string from PROGMEM for modem output comparision
-volatile static uint8_t battery[10] = "0000000000";  // for battery voltage checking
-volatile static uint8_t battery_pos = 0;
+static uint8_t battery[10] = "0000000000";  // for battery voltage checking
+static uint8_t battery_pos = 0;
+
+// last good GNSS fix used for DEAD RECKONING when GNSS is unable to fix ( tunnel, parking structure )
+static int32_t lastfixlat = 0;       // microdegrees
+static int32_t lastfixlong = 0;      // microdegrees
+static uint16_t lastfixspeed = 0;    // 0.1 km/h
+static uint16_t lastfixcourse = 0;   // degrees
+static uint32_t lastfixtime = 0;     // timebase seconds when last good fix was taken, 0 = no fix yet
 
 // other flags and counters
-volatile static uint8_t continousgps = 0;
+static uint8_t continousgps = 0;
+static uint8_t multicount = MULTICOUNT;          // number of MULTI positions requested
+static uint16_t multiinterval = MULTIINTERVAL;   // seconds between MULTI positions
+static uint16_t httpinterval = HTTPINTERVAL;     // seconds between HTTP posts
+static uint32_t nextreport = 0;                  // timebase second of next periodic report deadline
+
+// COMBINED ACKNOWLEDGE and packing of MULTI positions into one SMS
+static uint8_t combinedack = COMBINEDACK;        // option enabled
+static uint8_t ackpending = 0;                   // acknowledge SMS not sent yet
+static const char *ackmsg;                       // PROGMEM acknowledge text to send if fix is late
+static uint16_t packsms_pos = 0;                 // length of packed MULTI positions "hhmmss lat,lon" one per line
+
+// SMS composed from RAM and PROGMEM fragments - streamed to UART in text or PDU mode without copying
+static uint8_t smspdu = SMSPDU;                  // option enabled
+static const char *smsfrag[SMSFRAGS];
+static uint16_t smsfragflash;                    // bit n set means fragment n is PROGMEM string
+static uint8_t smsfrag_nbr = 0;
+static uint16_t pduacc;                          // GSM 7-bit packing accumulator
+static uint8_t pdubits;                          // number of bits waiting in accumulator
+static uint8_t pduparts;                         // number of concatenated parts of SMS
+static uint8_t pduref = 0;                       // reference number of concatenated SMS
+
+// SMS delivery reports +CDS
+static uint16_t smsdelivered = 0;
+static uint16_t smsundelivered = 0;
+static uint8_t lastcdsmr = 0;                    // message reference of last delivery report
+static uint8_t lastcdsstatus = 0;                // status of last delivery report, 0 = delivered
+
+// outbound SMS queue - SMS which were not accepted are kept as "number\0text\0", packed positions follow
+static uint8_t smsqueue[SMSQUEUESIZE];
+static uint16_t smsqueue_len = 0;
+static uint16_t smssent = 0;                     // SMS accepted by network
+static uint16_t smsfailed = 0;                   // SMS not accepted after all attempts - queued
+static uint16_t smsdropped = 0;                  // SMS lost because queue was full
+static uint8_t lastcmgsmr = 0;                   // message reference of last accepted SMS
+
+// STOP command received during preemptible wait - MULTI, GUARD or HTTP mode is ended at once
+static uint8_t stoprequest = 0;
+
+// alarm input
+static uint8_t alarminput = ALARMINPUT;          // option enabled
+volatile static uint8_t alarmflag = 0;           // alarm input triggered, cleared when alarm SMS is sent
+volatile static uint8_t alarmactive = 0;         // debounced state of alarm input, 1 = active
+volatile static uint8_t alarmlevel = 0;          // last sampled state of alarm input
+volatile static uint8_t alarmstable = 0;         // number of TIMER0 ticks with unchanged input
+static uint8_t gnssstarted = 0;                  // GNSS already powered on and searching - no cold start needed
+
+// car battery ADC - sums and counters are modified by ADC and TIMER1 interrupts
+volatile static uint8_t adcmode = 0;             // 0 = idle, 1 = background sample, 2 = on-demand reading
+volatile static uint8_t adctimer = ADCPERIOD;    // seconds to next background sample
+volatile static uint16_t adcleft = 0;            // conversions left in running sample
+volatile static uint32_t adcsum = 0;             // sum of conversions of running sample
+volatile static uint16_t adclast = 0;            // last background sample, 12-bit
+volatile static uint16_t adcmin = 0xFFFF;        // lowest background sample since last reading
+volatile static uint16_t adcmax = 0;             // highest background sample since last reading
+volatile static uint32_t adcaggsum = 0;          // sum of background samples since last reading
+volatile static uint16_t adcaggcount = 0;        // number of background samples since last reading
+volatile static uint8_t adcnew = 0;              // new background sample for car battery alerts
+
+// car battery alerts
+static uint8_t carbattalerts = CARBATTALERTS;    // option enabled
+static uint8_t carbattstate = CARBATTOK;         // confirmed state of car battery
+static uint8_t carbattpending = CARBATTOK;       // state waiting for dwell time
+static uint32_t carbattsince = 0;                // timebase second when pending state was entered
+static uint32_t carbattalerted[4];               // timebase second of last alert for every state, 0 = never
+static uint8_t carbatthttp = 0;                  // alert to be posted with next HTTP position
+
+// ignition detection
+volatile static uint8_t ignitionnew = 0;         // new background sample for ignition detection
+static uint8_t engine = 0;                       // 1 = engine running
+static uint8_t enginelevel = 0;                  // last sample was above charging level
+static uint32_t enginesince = 0;                 // timebase second when sample level changed
+static uint8_t ignitiontracked = 0;              // tracking was started for this engine run
+static uint8_t ignitionsession = 0;              // running session : 1 = tracking started by engine, 2 = GUARD armed after engine stopped
+static uint8_t autoguardpending = 0;             // GUARD MODE is to be armed
+
+// power profiles
+static uint8_t powerprofile = POWERNORMAL;       // POWERNORMAL, POWERSAVER or POWERCRITICAL
+static uint8_t lastgaspsent = 0;                 // last gasp report was sent, cleared when supply recovers
+
+// energy accounting
+static uint8_t energyactive = 0;                 // bit per state which is active now
+static uint32_t energysince[ENERGYSTATES];       // timebase second when active state was entered
+static uint32_t energytime[ENERGYSTATES];        // seconds spent in every state
+static uint32_t energysaved = 0;                 // timebase second of last save to EEPROM
+
+// statistics
+extern char __heap_start;                        // first byte above static variables - stack grows down to it
+static uint8_t resetcause = 0;                   // MCUSR at power on
+static uint8_t statshttp = 0;                    // statistics are posted with next HTTP post
+static uint16_t gnsssearches = 0;                // GNSS position requests
+static uint16_t gnssfixes = 0;                   // GNSS position requests with fix
+static uint32_t ttffstart = 0;                   // timebase second of GNSS power on, 0 = first fix already counted
+static uint32_t ttffsum = 0;                     // sum of times to first fix
+static uint16_t ttffcount = 0;                   // number of times to first fix
+static uint16_t ttfflast = 0;                    // last time to first fix
+static uint16_t smsretries = 0;                  // SMS attempts repeated after backoff
+static uint16_t httpposts = 0;                   // HTTP posts sent
+static uint16_t httpok = 0;                      // HTTP posts answered by status 2xx
+static uint16_t bearerretries = 0;               // IP bearer attach attempts repeated
+static uint16_t regsearches = 0;                 // network searches after registration was lost
+static uint16_t regtime = 0;                     // seconds of last succesful network search
+static uint16_t uartoverruns = 0;                // chars lost by UART data overrun
+
+// GNSS acquisition histogram - saved to EEPROM at EEGNSSADDR followed by CRC
+struct gnsslog {
+  uint16_t bucket[GNSSMODES][GNSSBUCKETS];       // fixes by time to fix and timeouts
+  uint32_t sats[GNSSMODES];                      // sum of satellites used at fix
+};
+static struct gnsslog gnsslog;
+static uint8_t gnssstartmode = GNSSCOLD;         // GNSSCOLD or GNSSWARM - last restart command
+static uint8_t satsused = 0;                     // satellites used by last fix
+
+#if ATTRACE
+// AT trace ring - entry is command in PROGMEM, milliseconds and response class
+struct traceentry {
+  const char *cmd;
+  uint16_t ms;
+  uint8_t result;
+};
+static struct traceentry trace[TRACESIZE];
+static uint8_t tracehead = 0;                    // slot of next entry
+static uint8_t tracecount = 0;                   // number of valid entries
+static uint8_t traceopen = 0;                    // last entry : 0 = closed, 1 = waiting for response, 2 = response started
+static uint32_t tracestart = 0;                  // millisecond when last command was sent
+#endif
+
+// SMS inbox mode
+static uint8_t smsinbox = SMSINBOX;              // option enabled
+static uint8_t smsindex = 0;                     // index of stored SMS being processed, 0 = none
+static const char *delsms = DELSMS;              // command to clean SMS memory - in inbox mode unread SMS are kept
+static uint8_t estimated = 0;                 // flag that reported position is estimated by dead reckoning
+volatile static uint32_t uptime = 0;          // seconds since power on, advanced by TIMER1 interrupt
+
+// SOFT RTC - UTC seconds since 2000-01-01 00:00:00 taken at timebase second 'rtcbaseuptime'
+static uint32_t rtcbase = 0;
+static uint32_t rtcbaseuptime = 0;
+static int32_t rtcdrift = 0;         // measured timebase error in ppm, positive when timebase runs slow
+static uint8_t rtcsource = 0;        // 0 = not set, 1 = network time AT+CCLK, 2 = GNSS UTC
+static uint32_t rtcrefutc = 0;       // reference GNSS synchronization for drift measurement
+static uint32_t rtcrefuptime = 0;
+
+// CONFIGURATION - block stored in EEPROM at EECONFADDR protected by CRC, numbers are cached in RAM
+// and strings are read from EEPROM when needed
+struct confentry {
+  uint8_t version;          // CONFVERSION
+  uint16_t guard;           // GUARD ALERT distance in meters
+  uint16_t guardinterval;   // seconds between GUARD position checks
+  uint8_t multicount;       // default number of MULTI positions
+  uint16_t multiinterval;   // default seconds between MULTI positions
+  uint16_t httpinterval;    // default seconds between HTTP posts
+  uint8_t ignition;         // tracking started by engine : 0 = off, 1 = MULTI, 2 = HTTP
+  uint16_t ignitionoff;     // seconds of engine off before tracking stops
+  uint8_t autoguard;        // 1 = arm GUARD MODE after engine stopped
+  uint16_t current[ENERGYSTATES];   // current of energy accounting states in 0.1mA
+};
+struct confblock {
+  struct confentry n;
+  char pin[9];
+  char apn[25];
+  char user[17];
+  char pwd[17];
+  char url[41];
+  uint16_t crc;
+};
+static struct confentry conf;
+static uint8_t pinsent = 0;          // PIN was entered and SIM did not report READY yet - wrong PIN is never sent twice
+
+// WHITELIST - hashes of normalized numbers stored in EEPROM, 0 = empty entry
+static uint16_t whitehash[WHITESLOTS];
+
+// SCHEDULED REPORTS - entry stored in EEPROM at EESCHEDADDR
+struct schedentry {
+  uint16_t minute;     // minute of day in local time 0-1439, 0xFFFF = empty entry
+  uint8_t days;        // bit 0 = Monday ... bit 6 = Sunday
+  uint8_t action;      // 1 = SINGLE position, 2 = MULTI positions
+};
+static uint32_t schedtime = 0;       // UTC time of next scheduled report
+static uint32_t schedlast = 0;       // UTC time of last triggered scheduled report - not to repeat it
+static uint32_t scheddue = 0;        // UTC time when triggered report should be delivered, 0 = none
+static uint8_t schedaction = 0;      // action of next scheduled report
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// TIMEBASE - TIMER1 in CTC mode gives 1 second tick with single interrupt per second
+// so it costs almost nothing and is independent of delay_sec() busy loops
+//////////////////////////////////////////////////////////////////////////////////
+
+void init_timebase(void)
+{
+  TCCR1A = 0;                               // normal port operation
+  TCCR1B = (1<<WGM12) | (1<<CS11) | (1<<CS10);   // CTC mode with OCR1A as TOP, prescaler 64
+  OCR1A = TIMEBASE_TOP;                     // 15625 ticks = 1 second at 1MHz
+  TIMSK1 |= (1<<OCIE1A);                    // enable compare match interrupt
+}
+
+// every second increase uptime counter and start background car battery sample every ADCPERIOD seconds
+ISR(TIMER1_COMPA_vect)
+{
+  uptime++;
+
+  if (--adctimer == 0)
+     {
+      adctimer = ADCPERIOD;
+      if (adcmode == 0)
+         {
+          adcmode = 1;
+          adcsum = 0;
+          adcleft = ADCBACKGROUND;
+          ADCSRA |= (1<<ADSC);           // next conversions are started by ADC interrupt
+         };
+     };
+}
+
+// read 32-bit uptime counter atomically - it is modified by ISR
+uint32_t getuptime(void)
+{
+  uint32_t seconds;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+     {
+      seconds = uptime;
+     };
+  return seconds;
+}
+
+#if ATTRACE
+// milliseconds of timebase from TIMER1 count - compare match may wait for interrupt while reading
+uint32_t getmillis(void)
+{
+  uint32_t seconds;
+  uint16_t ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+     {
+      seconds = uptime;
+      ticks = TCNT1;
+      if ( (TIFR1 & (1<<OCF1A)) && (ticks < (TIMEBASE_TOP / 2)) )  seconds++;
+     };
+  return (seconds * 1000UL + (ticks * 64UL) / 1000UL);
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENERGY ACCOUNTING - SIM7000 commands and SMS sending switch states, time in every state
+// is accumulated from timebase and charge is estimated from currents in configuration
+//////////////////////////////////////////////////////////////////////////////////
+
+void energyon(uint8_t state)
+{
+  if (energyactive & (1 << state)) return;
+  energyactive |= (1 << state);
+  energysince[state] = getuptime();
+}
+
+void energyoff(uint8_t state)
+{
+  if ( !(energyactive & (1 << state)) ) return;
+  energyactive &= ~(1 << state);
+  energytime[state] += getuptime() - energysince[state];
+}
+
+// close running intervals of active states up to now
+void energyupdate(void)
+{
+  uint8_t state;
+  uint32_t now;
+
+  now = getuptime();
+  for (state = 0; state < ENERGYSTATES; state++)
+     {
+      if ( !(energyactive & (1 << state)) ) continue;
+      energytime[state] += now - energysince[state];
+      energysince[state] = now;
+     };
+}
+
+// SIM7000 is in one of states : awake, CSCLK sleep or flight mode
+void energymodem(uint8_t state)
+{
+  energyoff(E_AWAKE);
+  energyoff(E_SLEEP);
+  energyoff(E_FLIGHT);
+  energyon(state);
+}
+
+// follow PROGMEM commands which change power consumption of SIM7000 - GNSS commands also for statistics
+void energycommand(const char *s)
+{
+  if      (s == FLIGHTON)    energymodem(E_FLIGHT);
+  else if (s == FLIGHTOFF)   energymodem(E_AWAKE);
+  // CSCLK does not wake up radio in flight mode
+  else if ( (s == SLEEPON) && !(energyactive & (1 << E_FLIGHT)) )   energymodem(E_SLEEP);
+  else if ( (s == SLEEPOFF) && !(energyactive & (1 << E_FLIGHT)) )  energymodem(E_AWAKE);
+  else if (s == GPSPWRON)
+     {
+      // time to first fix is counted from GNSS power on
+      if ( !(energyactive & (1 << E_GNSS)) )  ttffstart = getuptime();
+      energyon(E_GNSS);
+     }
+  else if (s == GPSPWROFF)
+     {
+      ttffstart = 0;
+      energyoff(E_GNSS);
+     }
+  else if (s == GPSCLDSTART)   gnssstartmode = GNSSCOLD;
+  else if (s == GPSWARMSTART)  gnssstartmode = GNSSWARM;
+  else if (s == SAPBROPEN)   energyon(E_BEARER);
+  else if (s == SAPBRCLOSE)  energyoff(E_BEARER);
+}
+
+// index of state which name starts 'name', ENERGYSTATES if there is no such state
+uint8_t energystate(const char *name)
+{
+  uint8_t state;
+  const char *p;
+
+  for (state = 0; state < ENERGYSTATES; state++)
+     {
+      p = (const char *)pgm_read_word(&ENERGYNAMES[state]);
+      if (strncasecmp_P(name, p, strlen_P(p)) == 0)  break;
+     };
+return(state);
+}
+
+
+#if ATTRACE
+//////////////////////////////////////////////////////////////////////////////////
+// AT TRACE - commands are recorded by uart_puts_P, first response character by receive_uart
+// and response lines by readline, so all AT traffic is traced without changes in callers
+//////////////////////////////////////////////////////////////////////////////////
+
+// milliseconds since last command was sent, limited to 16 bits
+uint16_t traceelapsed(void)
+{
+  uint32_t ms;
+
+  ms = getmillis() - tracestart;
+  if (ms > 0xFFFF)  ms = 0xFFFF;
+return(ms);
+}
+
+// close last entry - response which was not read is timed until now
+void traceclose(void)
+{
+  if (traceopen == 1)  trace[(tracehead + TRACESIZE - 1) % TRACESIZE].ms = traceelapsed();
+  traceopen = 0;
+}
+
+// record AT command sent from PROGMEM, other strings ( URL or SMS text parts ) are not traced
+void tracecommand(const char *s)
+{
+  if ( (pgm_read_byte(s) != 'A') || (pgm_read_byte(s + 1) != 'T') )  return;
+  traceclose();
+  trace[tracehead].cmd = s;
+  trace[tracehead].ms = 0;
+  trace[tracehead].result = TRACENONE;
+  tracehead = (tracehead + 1) % TRACESIZE;
+  if (tracecount < TRACESIZE)  tracecount++;
+  tracestart = getmillis();
+  traceopen = 1;
+}
+
+// first character of response
+void tracechar(void)
+{
+  trace[(tracehead + TRACESIZE - 1) % TRACESIZE].ms = traceelapsed();
+  traceopen = 2;
+}
+
+// response line - final result code closes the entry
+void traceline(const char *line)
+{
+  uint8_t last;
+
+  if (traceopen == 0)  return;
+  last = (tracehead + TRACESIZE - 1) % TRACESIZE;
+  if (strcmp_P(line, ISOK) == 0)
+     {
+      trace[last].result = TRACEOK;
+      traceopen = 0;
+     }
+  else if (strstr_P(line, ISERROR) != NULL)
+     {
+      trace[last].result = TRACEERROR;
+      traceopen = 0;
+     }
+  else trace[last].result = TRACEDATA;
+}
+#endif
 
 
 // ----------------------------------------------------------------------------------------------
@@ -248,25 +1016,30 @@ void send_uart(uint8_t c) {
 uint8_t receive_uart() {
   while ( !(UCSR0A & (1<<RXC0)) ) 
     ; 
+  if (UCSR0A & (1<<DOR0))  uartoverruns++;    // chars were lost before this one
+#if ATTRACE
+  if (traceopen == 1)  tracechar();
+#endif
   return UDR0; 
 }
 
 
 // ----------------------------------------------------------------------------------------------
 // function to search RX buffer for response  SUB IN RX_BUFFER STR
+// SUB is compared directly from PROGMEM without copy to RAM, search ends at the end of STR
+// or after 'buffersize' chars, so it never reads past the buffer
 // ----------------------------------------------------------------------------------------------
-uint8_t is_in_rx_buffer(char *str, char *sub, uint8_t buffersize) {
-   uint8_t i, j=0, k;
-    for(i=0; i<buffersize; i++)
+uint8_t is_in_rx_buffer_P(const char *str, const char *sub, uint8_t buffersize) {
+   uint8_t i, k;
+   const char *p;
+   char c;
+    for(i=0; (i<buffersize) && str[i]; i++)
     {
-      if(str[i] == sub[j])
-     {
-       for(k=i, j=0; str[k] && sub[j]; j++, k++)  // if NOT NULL on each of strings
-            if(str[k]!=sub[j])   break; // if different - start comparision with next char
-       // if(!sub[j]) return 1; 
-        if(j == strlen(sub)) return 1;  // full substring has been found        
-      }
-     }
+       // compare SUB with STR from this position until first difference
+       for(k=i, p=sub; ((c = pgm_read_byte(p)) != 0x00) && (k<buffersize) && (str[k]==c); k++, p++)
+            ;
+       if (c == 0x00) return 1;  // full substring has been found        
+    }
      // substring not found
     return 0;
 }
@@ -284,6 +1057,17 @@ void uart_puts(const char *s) {
   }
 }
 
+// ----------------------------------------------------------------------------------------------
+// uart_putu
+// Sends unsigned number in decimal.
+// ----------------------------------------------------------------------------------------------
+void uart_putu(uint32_t value) {
+  char digits[11];
+
+  ultoa(value, digits, 10);
+  uart_puts(digits);
+}
+
 
 
 // ----------------------------------------------------------------------------------------------
@@ -291,12 +1075,297 @@ void uart_puts(const char *s) {
 // Sends a PROGMEM string.
 // ----------------------------------------------------------------------------------------------
 void uart_puts_P(const char *s) {
+  energycommand(s);
+#if ATTRACE
+  tracecommand(s);
+#endif
   while (pgm_read_byte(s) != 0x00) {
     send_uart(pgm_read_byte(s++));
   }
 }
 
 
+//////////////////////////////////////////////////////////////////////////////////
+// ALARM INPUT - INT1 on LOW level wakes up MCU ( edge interrupts cannot wake it up from power down )
+// then INT1 is disabled and TIMER0 samples the input every 10ms until it is stable
+//////////////////////////////////////////////////////////////////////////////////
+
+void init_alarm(void)
+{
+  DDRD &= ~(1 << DDD3);     // Clear the PD3 pin - PD3 (INT1 pin) is now an input
+  PORTD |= (1 << PORTD3);   // turn On the Pull-up - PD3 is now an input with pull-up enabled
+
+  TCCR0A = (1<<WGM01);      // CTC mode with OCR0A as TOP, TIMER0 is stopped until INT1
+  TCCR0B = 0;
+  OCR0A = ALARMTICK;
+  TIMSK0 |= (1<<OCIE0A);    // enable compare match interrupt
+
+  EICRA &= ~(1 << ISC11);   // set INT1 to trigger on low level
+  EICRA &= ~(1 << ISC10);   // set INT1 to trigger on low level
+  EIMSK |= (1 << INT1);     // Turns on INT1 (set bit)
+}
+
+// alarm input went LOW - low level would trigger INT1 continously so disable it and start debouncing
+ISR(INT1_vect)
+{
+  EIMSK &= ~(1 << INT1);     // Turns off INT1 (clear bit)
+  alarmlevel = 1;
+  alarmstable = 0;
+  TCNT0 = 0;
+  TCCR0B = (1<<CS01) | (1<<CS00);   // start TIMER0 with prescaler 64
+}
+
+// every 10ms sample alarm input, trigger alarm once when it is stable LOW and rearm INT1 when it is stable HIGH
+ISR(TIMER0_COMPA_vect)
+{
+  uint8_t level;
+
+  level = ((PIND & (1 << PIND3)) == 0) ? 1 : 0;
+  if (level != alarmlevel)
+     {
+      alarmlevel = level;
+      alarmstable = 0;
+      return;
+     };
+  if (alarmstable < ALARMDEBOUNCE)
+     {
+      alarmstable++;
+      return;
+     };
+
+  if (level == 1)
+     {   // keep sampling until alarm input is released
+      if (alarmactive == 0)  alarmflag = 1;
+      alarmactive = 1;
+     }
+  else
+     {
+      alarmactive = 0;
+      TCCR0B = 0;                // stop TIMER0
+      EIMSK |= (1 << INT1);      // Turns on INT1 again
+     };
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// CAR BATTERY ADC - conversions end with ADC interrupt, no busy waiting on ADSC
+// oversampling by 4^n conversions adds n bits of resolution : 16x = 12-bit, 256x = 14-bit
+//////////////////////////////////////////////////////////////////////////////////
+
+void init_adc(void)
+{
+  ADMUX = (1<<REFS0) | (ADC_PIN & 0x0F);   // Vref = AVcc, select ADC channel with safety mask
+  DIDR0 |= (1<<ADC_PIN);                   // disable digital input buffer on analog pin to save power
+  // prescaler 8 and enable ADC with interrupt (1MHz clock : 8 = 125kHz) - ADC clock frequency must be between 50-200kHz
+  ADCSRA = (1<<ADEN) | (1<<ADIE) | (1<<ADPS1) | (1<<ADPS0);
+}
+
+// conversion finished - add it to running sample
+ISR(ADC_vect)
+{
+  uint16_t sample;
+
+  if (adcleft == 0) return;             // conversion started by extra sleep is not needed
+  adcsum += ADC;
+  adcleft--;
+  // on-demand conversions are started by entering ADC noise reduction sleep
+  if (adcmode != 1) return;
+  if (adcleft > 0)
+     {
+      ADCSRA |= (1<<ADSC);
+      return;
+     };
+
+  // 16 conversions of 10-bit give 12-bit background sample
+  sample = adcsum >> 2;
+  adclast = sample;
+  if (sample < adcmin)  adcmin = sample;
+  if (sample > adcmax)  adcmax = sample;
+  adcaggsum += sample;
+  adcaggcount++;
+  adcnew = 1;
+  ignitionnew = 1;
+  adcmode = 0;
+}
+
+// on-demand 14-bit reading in ADC noise reduction sleep - CPU and I/O clocks are stopped during conversions
+// so SIM7000 should be quiet, UART receiver does not work in this sleep mode
+uint16_t adcread(void)
+{
+  uint8_t busy = 1;
+
+  // let background sample finish first - test and claim ADC in one critical section,
+  // timer ISR may start a background sample between them otherwise
+  while (busy)
+     {
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+         {
+          if (adcmode == 0)
+             {
+              adcmode = 2;
+              adcsum = 0;
+              adcleft = ADCPRECISE;
+              busy = 0;
+             };
+         };
+     };
+
+  set_sleep_mode(SLEEP_MODE_ADC);
+  while (adcleft > 0)
+     {
+      cli();
+      if (adcleft > 0)
+         {
+          sleep_enable();
+          sei();                 // next instruction is executed before any interrupt - no lost wake up
+          sleep_cpu();           // conversion starts when ADC noise reduction sleep is entered
+          sleep_disable();
+         };
+      sei();
+     };
+  adcmode = 0;
+
+  // 256 conversions of 10-bit give 14-bit result
+return(adcsum >> 4);
+}
+
+// convert ADC value of 'bits' resolution to CAR BATTERY voltage in [mV]
+uint16_t carbattery(uint32_t value, uint8_t bits)
+{
+  // scale the result to Vref : VOLTAGE = Vin * (Vref * 1000) / 2^bits
+  value = (value * VREF_VOLTAGE) >> bits;
+  // real value of CAR BATTERY Voltage using multiplication by Resistor divider factor
+  value = (value * VFACTOR) / 1000UL;
+  // add diode drop value if there is DIODE protecting ATMEGA328P from negative voltage
+return(value + VDIODE);
+}
+
+// append voltage in [mV] as "V.vv" to 'out' buffer, returns pointer to end of string
+uint8_t *carbatteryvolts(uint8_t *out, uint16_t millivolts)
+{
+  utoa(millivolts / 1000, out, 10);
+  out += strlen(out);
+  *out++ = '.';
+  millivolts = (millivolts % 1000) / 10;
+  *out++ = '0' + millivolts / 10;
+  *out++ = '0' + millivolts % 10;
+  *out = 0x00;
+return(out);
+}
+
+// list precise reading and MIN / MAX / AVG of background samples since last listing to 'out' buffer
+void carbatterylist(uint8_t *out)
+{
+  uint16_t low, high, count;
+  uint32_t sum;
+
+  out = carbatteryvolts(out, carbattery(adcread(), 14));
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+     {
+      low = adcmin;
+      high = adcmax;
+      sum = adcaggsum;
+      count = adcaggcount;
+      adcmin = 0xFFFF;
+      adcmax = 0;
+      adcaggsum = 0;
+      adcaggcount = 0;
+     };
+  if (count == 0) return;
+
+  strcpy_P(out, CARBATTMIN);
+  out = carbatteryvolts(out + strlen(out), carbattery(low, 12));
+  strcpy_P(out, CARBATTMAX);
+  out = carbatteryvolts(out + strlen(out), carbattery(high, 12));
+  strcpy_P(out, CARBATTAVG);
+  carbatteryvolts(out + strlen(out), carbattery(sum / count, 12));
+}
+
+// state of car battery for 'millivolts' - threshold of 'current' state is moved by hysteresis
+uint8_t carbattlevel(uint16_t millivolts, uint8_t current)
+{
+  uint16_t under, disc, over;
+
+  under = CARBATTUNDER_LVL;
+  disc = CARBATTDISC_LVL;
+  over = CARBATTOVER_LVL;
+  if (current == CARBATTWEAK)          under += CARBATTHYST;
+  if (current == CARBATTDISCONNECTED)  disc += CARBATTHYST;
+  if (current == CARBATTOVERLOADED)    over -= CARBATTHYST;
+
+  if (millivolts < disc)   return(CARBATTDISCONNECTED);
+  if (millivolts < under)  return(CARBATTWEAK);
+  if (millivolts > over)   return(CARBATTOVERLOADED);
+return(CARBATTOK);
+}
+
+// check new background sample, returns 1 if car battery state changed and alert is to be sent
+uint8_t carbattmonitor(void)
+{
+  uint8_t state;
+  uint32_t now;
+
+  if (adcnew == 0) return(0);
+  adcnew = 0;
+
+  state = carbattlevel(carbattery(adclast, 12), carbattstate);
+  now = getuptime();
+  // new state must last for dwell time
+  if (state != carbattpending)
+     {
+      carbattpending = state;
+      carbattsince = now;
+     };
+  if ( (state == carbattstate) || ((now - carbattsince) < CARBATTDWELL) )  return(0);
+  carbattstate = state;
+
+  // rate limit of repeated alerts when voltage is oscillating
+  if ( (carbattalerted[state] != 0) && ((now - carbattalerted[state]) < CARBATTREPEAT) )  return(0);
+  carbattalerted[state] = now;
+  carbatthttp = 1;
+return(1);
+}
+
+// check new background sample for engine start and stop, 'engine' follows charging voltage with hysteresis
+// returns 1 when engine started, 2 when engine is off for configured delay
+uint8_t ignitionmonitor(void)
+{
+  uint8_t level;
+  uint16_t millivolts;
+  uint32_t now;
+
+  if (ignitionnew == 0) return(0);
+  ignitionnew = 0;
+
+  millivolts = carbattery(adclast, 12);
+  if (engine == 1)  level = (millivolts > (IGNITION_LVL - IGNITIONHYST)) ? 1 : 0;
+  else              level = (millivolts > IGNITION_LVL) ? 1 : 0;
+  now = getuptime();
+  if (level != enginelevel)
+     {
+      enginelevel = level;
+      enginesince = now;
+     };
+  if (level == engine)  return(0);
+
+  if ( (level == 1) && ((now - enginesince) >= IGNITIONON) )
+     {
+      engine = 1;
+      autoguardpending = 0;
+      return(1);
+     };
+  if ( (level == 0) && ((now - enginesince) >= conf.ignitionoff) )
+     {
+      engine = 0;
+      ignitiontracked = 0;
+      autoguardpending = conf.autoguard;
+      return(2);
+     };
+return(0);
+}
+
+
 // ------------------------------------------------------------------------------------------------------------
 // READLINE from serial port that starts with CRLF and ends with CRLF and put to 'response' buffer what read
 // ------------------------------------------------------------------------------------------------------------
@@ -331,6 +1400,9 @@ uint8_t readline()
       i++;
       } while ( (wholeline == 0) && (i<150) );
 
+#if ATTRACE
+  if (wholeline == 1)  traceline(response);
+#endif
 return(1);
 }
 
@@ -376,8 +1448,9 @@ return(1);
 
 // ----------------------------------------------------------------------------------------------------------------------------
 // read SMS message PHONE NUMBER from +CMT: output and response buffer and copy it to buffer 'phonenumber' for SMS sending
+// 'skip' is number of quoted fields before the number - 0 for +CMT:, 1 for +CMGL: where status of SMS comes first
 // ----------------------------------------------------------------------------------------------------------------------------
-uint8_t readsmsphonenumber()
+uint8_t readsmsphonenumber(uint8_t skip)
 {
   // need 8bit ascii 
   uint8_t char1;
@@ -397,6 +1470,22 @@ uint8_t readsmsphonenumber()
            i++;
          } while ( (char1 != ':') && (i<150) );
 
+      // skip quoted fields before the number
+      while (skip > 0)
+         {
+          do { 
+               char1 = response[response_pos];
+               response_pos++;
+               i++;
+             } while ( (char1 != '\"') && (i<150) );
+          do { 
+               char1 = response[response_pos];
+               response_pos++;
+               i++;
+             } while ( (char1 != '\"') && (i<150) );
+          skip--;
+         };
+
       // wait for first quotation sign - there will be MSISDN number of sender
       do { 
            char1 = response[response_pos];
@@ -421,6 +1510,105 @@ uint8_t readsmsphonenumber()
 
 
 
+// ----------------------------------------------------------------------------------------------------------------------------
+// read list of unread SMS stored in SIM7000 in one AT+CMGL batch and take first one containing 'keyword' 
+// ( or first one at all if 'keyword' is NULL ) to 'smstext' and 'phonenumber', its index goes to 'smsindex'
+// returns 1 if SMS was found, other SMS stay unread in inbox for later
+// ----------------------------------------------------------------------------------------------------------------------------
+uint8_t readinbox(const char *keyword)
+{
+  uint8_t found, lines, header, index;
+
+  found = 0;
+  lines = 0;
+  header = 0;
+  smsindex = 0;
+
+  // empty RX buffer - there may be responses of previous commands
+  while (UCSR0A & (1<<RXC0)) index = UDR0; 
+
+  uart_puts_P(LISTSMS);
+
+  // list ends with OK or ERROR, every SMS is header line followed by text line
+  do {
+      if (header == 1)
+         {  // text of SMS
+          header = 0;
+          if (found == 1) { readline(); continue; };
+          readsmstxt();
+          // case of SMS text is kept for SET command
+          if ( (keyword != NULL) && (strcasestr_P(smstext, keyword) == NULL) ) continue;
+          // this SMS will be processed - header is still in 'response' buffer
+          readsmsphonenumber(1);
+          smsindex = index;
+          found = 1;
+          continue;
+         };
+
+      readline();
+      if ( (strcmp_P(response, ISOK) == 0) || (strcmp_P(response, ISERROR) == 0) ) break;
+      if (is_in_rx_buffer_P(response, ISLIST, BUFFER_SIZE) == 1)
+         {
+          index = atoi(strchr(response, ':') + 1);
+          header = 1;
+         };
+     } while ( ++lines < INBOXLINES );
+
+return(found);
+}
+
+// delete SMS processed from inbox by its index
+void deleteinbox(void)
+{
+  if (smsindex == 0) return;
+
+  uart_puts_P(DELSMSINDEX);
+  uart_putu(smsindex);
+  send_uart('\r');
+  delay_sec(2);
+  smsindex = 0;
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------------------------
+// find n-th parameter ( separated by spaces, counted from 1 ) after command word in 'smstext' buffer
+// returns pointer to first character of the parameter or NULL if there is no such parameter
+// ----------------------------------------------------------------------------------------------------------------------------
+uint8_t *smsparam(const char *command, uint8_t n)
+{
+  uint8_t *p;
+
+  p = strstr_P(smstext, command);
+  if (p == NULL) return(NULL);
+  p += strlen_P(command);
+
+  while (1)
+   {
+     while (*p == ' ') p++;              // skip separators
+     if (*p == 0x00)   return(NULL);     // end of SMS - no such parameter
+     if (n <= 1)       return(p);
+     while ( (*p != ' ') && (*p != 0x00) ) p++;    // skip this parameter
+     n--;
+   };
+}
+
+// read n-th numeric parameter of SMS command, returns 'def' if it is missing or out of <min,max> range
+uint16_t smsnumber(const char *command, uint8_t n, uint16_t min, uint16_t max, uint16_t def)
+{
+  uint8_t *p;
+  uint16_t value;
+
+  p = smsparam(command, n);
+  if ( (p == NULL) || (*p < '0') || (*p > '9') ) return(def);
+  value = atoi(p);
+  if ( (value < min) || (value > max) ) return(def);
+
+return(value);
+}
+
+
+
 // ----------------------------------------------------------------------------------------------
 // Read BATTERY VOLTAGE in milivolts from AT+CBC output and put results to 'battery' buffer
 // ----------------------------------------------------------------------------------------------
@@ -464,19 +1652,35 @@ return (1);
 
 
 // -----------------------------------------------------------------------------------------------------
-// READ SIM7000 GPS from AT+CGPSINF output and put output to 'lattitude' and 'longtitude' buffers
+// copy next comma separated field from UART to 'out' buffer of 'size' bytes, longer field is truncated
+// 'out' = NULL skips the field, returns safe fuse counter 'i' increased by number of read chars
+// -----------------------------------------------------------------------------------------------------
+uint8_t readgpsfield(uint8_t *out, uint8_t size, uint8_t i)
+{
+  uint16_t char1;
+  uint8_t pos;
+
+  pos = 0;
+  do  { 
+       char1 = receive_uart();
+       if ( (out != NULL) && (char1 != ',') && (pos < size - 1) )  out[pos++] = char1;
+       i++;
+     } while ( (char1 != ',') && (i<150) );
+  if (out != NULL)  out[pos] = 0x00;
+return(i);
+}
+
+
+// -----------------------------------------------------------------------------------------------------
+// READ SIM7000 GPS from AT+CGNSINF output and parse its fields in place to 'fix'
 // -----------------------------------------------------------------------------------------------------
 uint8_t readSIM7000gps()
 {
   uint16_t char1;
-  uint8_t i;
+  uint8_t i, field;
   
   // 'i' is a safe fuse not to get deadlock on serial port reading
   i = 0;
-
-  // set positions to start of each buffer
-   longtitude_pos = 0;
-   latitude_pos = 0;
  
    uart_puts_P(GPSINFO);      // try to retrieve GPS position
 
@@ -488,205 +1692,2172 @@ uint8_t readSIM7000gps()
       // check if deadlocked and buffer overrun, there should be +CGPSINF: within first 20 chars
          if (i == 20) return(0);
 
+      // we omit GNSPWR info and GNS fixation info
+      i = readgpsfield(NULL, 0, i);
+      i = readgpsfield(NULL, 0, i);
 
-      // wait for FIRST COMMA sign - we omit GNSPWR info
-      do { 
-           char1 = receive_uart();
-           i++;
-         } while ( (char1 != ',') && (i<150) );
+      // UTCTIME comes first, LATITUDE second and LONGTITUDE third
+      i = readgpsfield(fix.utctime, sizeof(fix.utctime), i);
+      i = readgpsfield(fix.latitude, sizeof(fix.latitude), i);
+      i = readgpsfield(fix.longtitude, sizeof(fix.longtitude), i);
 
-      // wait for SECOND COMMA sign - we omit GNS fixation info
-      do { 
-           char1 = receive_uart();
-           i++;
-         } while ( (char1 != ',') && (i<150) );
+      // now comes ATTITUDE - bypassing
+      i = readgpsfield(NULL, 0, i);
 
-      // if COMMA detected start to copy the response - UTCTIME comes first
-      do  { 
-           char1 = receive_uart();
-           utctime[utctime_pos] = char1; 
-           utctime_pos++;
-           i++;
-         } while ( (char1 != ',') && (i<150) );
-           // put end of string to latitude
-           utctime[utctime_pos-1] = NULL; 
-           utctime_pos=0;
+      // SPEED OVER GROUND in km/h and COURSE OVER GROUND in degrees - needed for dead reckoning
+      i = readgpsfield(fix.speed, sizeof(fix.speed), i);
+      i = readgpsfield(fix.course, sizeof(fix.course), i);
 
+      // now comes FIX MODE and RESERVED field - bypassing
+      i = readgpsfield(NULL, 0, i);
+      i = readgpsfield(NULL, 0, i);
 
-      // if COMMA detected start to copy the response - LATITUDE comes second
-      do  { 
-           char1 = receive_uart();
-           latitude[latitude_pos] = char1; 
-           latitude_pos++;
-           i++;
-         } while ( (char1 != ',') && (i<150) );
-           // put end of string to latitude
-           latitude[latitude_pos-1] = NULL; 
-           latitude_pos=0;
+      // HDOP is eleventh - needed for precision of short location code
+      i = readgpsfield(fix.hdop, sizeof(fix.hdop), i);
+      fix.measured = 1;
 
-          // if COMMA detected start to copy the response - LONGTITUDE is third
-      do  { 
-           char1 = receive_uart();
-           longtitude[longtitude_pos] = char1; 
-           longtitude_pos++;
-           i++;
-         } while ( (char1 != ',') && (i<150) );
-           longtitude[longtitude_pos-1] = NULL; 
-           longtitude_pos=0;
+      // now comes PDOP, VDOP, RESERVED field and SATELLITES IN VIEW - bypassing
+      for (field = 0; field < 4; field++)  i = readgpsfield(NULL, 0, i);
 
-          // now comes ATTITUDE - bypassing
+          // SATELLITES USED is sixteenth - needed for GNSS acquisition histogram
+      satsused = 0;
       do  { 
            char1 = receive_uart();
+           if ( (char1 >= '0') && (char1 <= '9') )  satsused = satsused * 10 + (char1 - '0');
            i++;
-         } while ( (char1 != ',') && (i<150) );
-
+         } while ( (char1 != ',') && (char1 != 0x0d) && (i<150) );
  
 return (1);
 }
 
 
 
-// --------------------------------------------------------------------------------------------------------------------
-// Power on GPS and retrieve position from GPS and put it to LOC and LATT buffers by calling 'readSIM7000gps' function
-// --------------------------------------------------------------------------------------------------------------------
-uint8_t readgpsinfo()
-{
-  uint8_t gpsattempts, gpsfixed;   // counter on attempts to get proper GPS position from SIM7000 - for indoor scenarios
-  gpsattempts = 0;
-  gpsfixed = 0;
+//////////////////////////////////////////////////////////////////////////////////
+// SMS COMPOSING - message is a list of RAM and PROGMEM fragments which are
+// streamed directly to UART, in PDU mode packed to GSM 7-bit alphabet
+//////////////////////////////////////////////////////////////////////////////////
 
+// start new SMS
+void smsbegin(void)
+{
+  smsfrag_nbr = 0;
+  smsfragflash = 0;
+}
 
+// append RAM string to SMS
+void smsadd(const char *s)
+{
+  if (smsfrag_nbr >= SMSFRAGS) return;
+  smsfrag[smsfrag_nbr++] = s;
+}
 
-  // if begining/last cycle of continous GPS mode we need to turn on and restart GPS module 
-  if ( (continousgps == 1) || (continousgps == 5) )
-      {   
-           delay_sec(1);
-           uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
-           delay_sec(2);  
-           uart_puts_P(GPSCLDSTART);   // cold start of SIM7000 GPS
-       }
-  else  // during continous mode cycle - we dont need to turn on and restart GPS module
-       {
-           delay_sec(1); 
-           // hot start of SIM7000 GPS if needed, otherwise simply poll GPS data
-           // uart_puts_P(GPSHOTSTART);   
-       }; 
-      
+// append PROGMEM string to SMS
+void smsadd_P(const char *s)
+{
+  if (smsfrag_nbr >= SMSFRAGS) return;
+  smsfragflash |= (1 << smsfrag_nbr);
+  smsfrag[smsfrag_nbr++] = s;
+}
 
+// convert ASCII to GSM 7-bit default alphabet, characters from extension table
+// are returned with 0x80 flag and must be preceded by escape 0x1B septet
+uint8_t gsm7bit(uint8_t c)
+{
+  switch (c)
+   {
+     case '@':  return 0x00;
+     case '$':  return 0x02;
+     case '_':  return 0x11;
+     case '^':  return 0x80 | 0x14;
+     case '{':  return 0x80 | 0x28;
+     case '}':  return 0x80 | 0x29;
+     case '\\': return 0x80 | 0x2F;
+     case '[':  return 0x80 | 0x3C;
+     case '~':  return 0x80 | 0x3D;
+     case ']':  return 0x80 | 0x3E;
+     case '|':  return 0x80 | 0x40;
+     case '`':  return '\'';
+   };
+  if (c >= 0x80) return '?';
+  return c;
+}
 
-  // now we have to wait some time until SIM7000 gets GPS signal, assume we are waiting 10 minutes 
-  // check the status in 30 sec intervals and then quit
-  do 
-  {
-          if ( continousgps != 255 )   delay_sec(15);      // in NOT in GUARD mode - wait 15 sec for first fix checking
+// send byte as two hex digits
+void pduhex(uint8_t b)
+{
+  uint8_t digit;
+  digit = b >> 4;
+  send_uart( (digit < 10) ? ('0' + digit) : ('A' - 10 + digit) );
+  digit = b & 0x0F;
+  send_uart( (digit < 10) ? ('0' + digit) : ('A' - 10 + digit) );
+}
 
-          uart_puts_P(GPSINFO);   // check GPS status
+// pack one septet to the bit stream, full octets are sent as hex
+void pduseptet(uint8_t septet)
+{
+  pduacc |= (uint16_t)(septet & 0x7F) << pdubits;
+  pdubits += 7;
+  if (pdubits >= 8)
+     {
+      pduhex(pduacc & 0xFF);
+      pduacc >>= 8;
+      pdubits -= 8;
+     };
+}
+
+// walk through all SMS fragments split to parts of 'limit' septets
+// returns number of septets in 'part' and sends them packed if 'emit' is set, total parts go to 'pduparts'
+// escape sequence is never split between two parts
+uint16_t pduwalk(uint8_t part, uint8_t limit, uint8_t emit)
+{
+  const char *p;
+  uint8_t frag, c, len, current, septets;
+  uint16_t result;
+
+  current = 0;
+  septets = 0;
+  result = 0;
+
+  for (frag = 0; frag < smsfrag_nbr; frag++)
+     {
+      p = smsfrag[frag];
+      while (1)
+         {
+          if (smsfragflash & (1 << frag))  c = pgm_read_byte(p);
+          else                             c = *p;
+          if (c == 0x00) break;
+          p++;
+
+          c = gsm7bit(c);
+          len = (c & 0x80) ? 2 : 1;
+          // next part begins if this character does not fit
+          if (septets + len > limit)
+             {
+              current++;
+              septets = 0;
+             };
+          septets += len;
+
+          if (current == part)
+             {
+              result += len;
+              if (emit)
+                 {
+                  if (c & 0x80) pduseptet(0x1B);     // escape to extension table
+                  pduseptet(c);
+                 };
+             };
+         };
+     };
+
+  pduparts = current + 1;
+  return result;
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+// wait for result of SMS sending - +CMGS: <mr> means SMS was accepted by network, ERROR or +CMS ERROR means rejected
+// returns 1 if accepted, 0 if rejected or there is no result within SMSTIMEOUT seconds
+// ----------------------------------------------------------------------------------------------------------------------------
+uint8_t smsresult(void)
+{
+  uint32_t deadline;
+
+  deadline = getuptime() + SMSTIMEOUT;
+  while (1)
+     {
+      // wait for next line from SIM7000 until deadline
+      while ( !(UCSR0A & (1<<RXC0)) )
+         {
+          if (getuptime() >= deadline) return(0);
+         };
+      readline();
+      if (strstr_P(response, ISCMGS) != NULL)
+         {
+          lastcmgsmr = atoi(strchr(response, ':') + 1);
+          return(1);
+         };
+      if (strstr_P(response, ISERROR) != NULL)  return(0);
+     };
+}
+
+// send SMS composed by smsadd() in PDU mode to 'number' - concatenated if longer than 160 characters,
+// text longer than SMSMAXPARTS parts goes on in next concatenated message, nothing is cut off
+// returns 1 if all parts were accepted by network
+uint8_t smssendpdu(const uint8_t *number)
+{
+  uint8_t digits, part, limit, octets, numbering, result, i;
+  uint8_t total, first, count;
+  uint16_t septets;
+
+  // international number starts with '+' which is not a digit of address
+  numbering = 0x81;
+  if (number[0] == '+')
+     {
+      numbering = 0x91;
+      number++;
+     };
+  digits = strlen(number);
+
+  // does it fit single SMS ?
+  limit = 160;
+  pduwalk(0, limit, 0);
+  if (pduparts > 1)
+     {
+      limit = 153;                      // 7 septets are taken by concatenation header
+      pduwalk(0, limit, 0);
+     };
+  total = pduparts;
+
+  uart_puts_P(SMSPDU0);
+  delay_sec(1); 
+
+  result = 1;
+  for (part = 0; (part < total) && (result == 1); part++)
+     {
+      // every SMSMAXPARTS parts start next concatenated message with its own reference
+      if ((part % SMSMAXPARTS) == 0)
+         {
+          first = part;
+          count = ((total - first) > SMSMAXPARTS) ? SMSMAXPARTS : (total - first);
+          pduref++;
+         };
+      septets = pduwalk(part, limit, 0);
+      if (total > 1) septets += 7;
+
+      // TPDU length without SMSC : first octet, MR, DA length, DA type, DA digits, PID, DCS, VP, UDL, UD
+      octets = 8 + (digits + 1) / 2 + (septets * 7 + 7) / 8;
+      uart_puts_P(SMSPDU1);
+      uart_putu(octets);
+      send_uart('\r');
+      delay_sec(1); 
+
+      pduhex(0x00);                                        // SMSC from SIM card
+      pduhex( (total > 1) ? 0x71 : 0x31 );                 // SMS-SUBMIT, relative validity, status report request, UDH indicator
+      pduhex(0x00);                                        // message reference set by SIM7000
+      pduhex(digits);                                      // destination address
+      pduhex(numbering);                                   // international or unknown numbering
+      for (i = 0; i < digits; i += 2)
+         {
+          if (i + 1 < digits) pduhex( ((number[i+1] - '0') << 4) | (number[i] - '0') );
+          else                pduhex( 0xF0 | (number[i] - '0') );
+         };
+      pduhex(0x00);                                        // PID
+      pduhex(0x00);                                        // DCS - GSM 7-bit default alphabet
+      pduhex(0xA7);                                        // validity 24 hours
+      pduhex(septets);                                     // UDL in septets
+
+      pduacc = 0;
+      pdubits = 0;
+      if (total > 1)
+         {   // concatenated SMS header : IEI 0, length 3, reference, total parts, this part
+          pduhex(0x05);
+          pduhex(0x00);
+          pduhex(0x03);
+          pduhex(pduref);
+          pduhex(count);
+          pduhex(part - first + 1);
+          pdubits = 1;                                     // fill bit to start septets on septet boundary
+         };
+      pduwalk(part, limit, 1);
+      if (pdubits > 0) pduhex(pduacc & 0xFF);              // last not full octet
+
+      // skip prompt - only result of sending is important
+      while (UCSR0A & (1<<RXC0)) i = UDR0; 
+      send_uart(26);   // ctrl Z to end SMS
+      result = smsresult();
+     };
+
+  // go back to text mode for incoming SMS
+  uart_puts_P(SMS1);
+  delay_sec(1); 
+
+return(result);
+}
+
+// send SMS composed by smsadd() to 'number' in PDU or text mode once
+// returns 1 if SMS was accepted by network
+uint8_t smstransmit(const uint8_t *number)
+{
+  uint8_t frag, result;
+
+  energyon(E_SMS);
+  if (smspdu == 1)
+     {
+      result = smssendpdu(number);
+      energyoff(E_SMS);
+      return(result);
+     };
+
+  uart_puts_P(SMS1);
+  delay_sec(1); 
+  // compose an SMS from fragments - interactive mode CTRL Z at the end
+  uart_puts_P(SMS2);
+  uart_puts(number);
+  uart_puts_P(CRLF);                                       
+  delay_sec(1); 
+  for (frag = 0; frag < smsfrag_nbr; frag++)
+     {
+      if (smsfragflash & (1 << frag))  uart_puts_P(smsfrag[frag]);
+      else                             uart_puts(smsfrag[frag]);
+     };
+  // skip prompt - only result of sending is important
+  while (UCSR0A & (1<<RXC0)) frag = UDR0; 
+  // end the SMS message
+  send_uart(26);   // ctrl Z to end SMS
+
+  result = smsresult();
+  energyoff(E_SMS);
+return(result);
+}
+
+// packed MULTI positions begin right after the last queued SMS
+uint8_t *packtext(void)
+{
+return(&smsqueue[smsqueue_len]);
+}
+
+// copy SMS composed by smsadd() to the end of outbound queue - packed positions are moved behind it,
+// SMS made of packed positions takes their place, number and fragments before them are put in front
+void smsenqueue(const uint8_t *number)
+{
+  uint16_t len, shift, pack;
+  uint8_t frag, owned, first;
+  uint8_t *out;
+
+  pack = (packsms_pos > 0) ? packsms_pos + 1 : 0;
+  owned = 0;
+  shift = 0;
+  len = strlen(number) + 1;
+  for (frag = 0; frag < smsfrag_nbr; frag++)
+     {
+      if (smsfragflash & (1 << frag))  len += strlen_P(smsfrag[frag]);
+      else
+         {
+          if ( (pack > 0) && (smsfrag[frag] == (const char *)packtext()) )
+             {
+              owned = 1;
+              shift = len;
+              pack = 0;
+             };
+          len += strlen(smsfrag[frag]);
+         };
+     };
+  len++;
+
+  // other SMS always leave room for one packed line and for queueing it with number and battery
+  if (owned == 0)  pack += PACKROOM + PACKLINE;
+  if (smsqueue_len + len + pack > SMSQUEUESIZE)
+     {
+      smsdropped++;
+      return;
+     };
+
+  out = packtext();
+  if (owned == 0)  shift = len;
+  if (packsms_pos > 0)  memmove(out + shift, out, packsms_pos + 1);
+  first = out[shift];
+  strcpy(out, number);
+  out += strlen(out) + 1;
+  for (frag = 0; frag < smsfrag_nbr; frag++)
+     {
+      if (smsfragflash & (1 << frag))  strcpy_P(out, smsfrag[frag]);
+      else if ( (owned == 1) && (smsfrag[frag] == (const char *)packtext()) )
+         {   // packed positions are already in place - only their first character was overwritten by string end
+          *out = first;
+          out += packsms_pos;
+          continue;
+         }
+      else  strcpy(out, smsfrag[frag]);
+      out += strlen(out);
+     };
+  *out = 0x00;
+  smsqueue_len += len;
+  if (owned == 1)  packsms_pos = 0;
+}
+
+// send SMS waiting in outbound queue back-to-back, stop at first one which is not accepted
+void smsflush(void)
+{
+  uint16_t len;
+
+  while (smsqueue_len > 0)
+     {
+      // first SMS in queue - number and text
+      len = strlen(smsqueue) + 1;
+      smsbegin();
+      smsadd(&smsqueue[len]);
+      if (smstransmit(smsqueue) == 0) return;
+      smssent++;
+
+      len += strlen(&smsqueue[len]) + 1;
+      // packed positions behind the queue move together with it
+      memmove(smsqueue, &smsqueue[len], smsqueue_len - len + ((packsms_pos > 0) ? packsms_pos + 1 : 0));
+      smsqueue_len -= len;
+     };
+}
+
+// send SMS composed by smsadd() to 'number', attempts are repeated with doubled backoff
+// SMS which was not accepted at all is queued and sent again later
+// returns 1 if SMS was accepted by network
+uint8_t smssend(const uint8_t *number)
+{
+  uint8_t attempt, backoff;
+
+  backoff = SMSBACKOFF;
+  for (attempt = 1; attempt <= SMSRETRIES; attempt++)
+     {
+      if (smstransmit(number) == 1)
+         {
+          smssent++;
+          // network is working - send also SMS waiting in queue
+          smsflush();
+          return(1);
+         };
+      if (attempt < SMSRETRIES)
+         {
+          smsretries++;
+          delay_sec(backoff);
+          backoff *= 2;
+         };
+     };
+
+  smsfailed++;
+  smsenqueue(number);
+return(0);
+}
+
+// ----------------------------------------------------------------------------------------------------------------------------
+// read SMS delivery report +CDS: fo,mr,"number",type,"scts","dt",st  from 'response' buffer and count delivered messages
+// ----------------------------------------------------------------------------------------------------------------------------
+uint8_t readdeliveryreport()
+{
+  uint8_t *p;
+
+  p = strchr(response, ',');
+  if (p == NULL) return(0);
+  lastcdsmr = atoi(p + 1);
+  p = strrchr(response, ',');
+  lastcdsstatus = atoi(p + 1);
+
+  // status 0-31 delivered, 32-63 still trying, 64 and more failed
+  if (lastcdsstatus < 32)       smsdelivered++;
+  else if (lastcdsstatus >= 64) smsundelivered++;
+
+return(1);
+}
+
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// send acknowledge SMS from PROGMEM text to 'phonenumber'
+// --------------------------------------------------------------------------------------------------------------------
+void sendack(const char *msg)
+{
+    smsbegin();
+    smsadd_P(msg);
+    smssend(phonenumber);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// WHITELIST - numbers allowed to control the tracker, stored in EEPROM at EEADDR
+// first entry is number stored by ACTIVATE, hashes are cached in RAM
+//////////////////////////////////////////////////////////////////////////////////
+
+// copy last WHITEDIGITS digits of 'number' to 'digits' ( left padded by '0' ) and return their hash
+// returns 0 if there are no digits at all - empty entry
+uint16_t whitenormalize(const uint8_t *number, uint8_t *digits)
+{
+  uint8_t count, skip, i, pos;
+  uint16_t hash;
+
+  // count digits - international prefix '+' or '00' and separators are ignored
+  count = 0;
+  for (i = 0; (i < 20) && (number[i] != 0x00); i++)
+     if ( (number[i] >= '0') && (number[i] <= '9') ) count++;
+  if (count == 0) return(0);
+
+  memset(digits, '0', WHITEDIGITS);
+  skip = (count > WHITEDIGITS) ? count - WHITEDIGITS : 0;
+  pos = (count < WHITEDIGITS) ? WHITEDIGITS - count : 0;
+  for (i = 0; (i < 20) && (number[i] != 0x00); i++)
+     {
+      if ( (number[i] < '0') || (number[i] > '9') ) continue;
+      if (skip > 0) { skip--; continue; };
+      digits[pos++] = number[i];
+     };
+
+  hash = 0xFFFF;
+  for (i = 0; i < WHITEDIGITS; i++)  hash = _crc_ccitt_update(hash, digits[i]);
+  if (hash == 0) hash = 1;
+return(hash);
+}
+
+// read whitelist from EEPROM and cache hashes of numbers in RAM
+void whiteload(void)
+{
+  uint8_t slot, number[20], digits[WHITEDIGITS];
+
+  for (slot = 0; slot < WHITESLOTS; slot++)
+     {
+      eeprom_read_block((void *)number, (const void *)(EEADDR + slot * 20), 20);
+      number[19] = 0x00;
+      whitehash[slot] = whitenormalize(number, digits);
+     };
+}
+
+// check if 'number' is in first 'slots' entries of whitelist - all of them are always compared so time of check
+// does not depend on which entry matched, matching hash is confirmed by comparing all digits stored in EEPROM
+// returns 1 if allowed, also when these entries are empty - first ACTIVATE takes the tracker
+uint8_t whitematch(const uint8_t *number, uint8_t slots)
+{
+  uint8_t slot, found, empty, diff, i;
+  uint8_t digits[WHITEDIGITS], stored[20], storeddigits[WHITEDIGITS];
+  uint16_t hash;
+
+  hash = whitenormalize(number, digits);
+  found = 0;
+  empty = 1;
+  for (slot = 0; slot < slots; slot++)
+     {
+      if (whitehash[slot] != 0)  empty = 0;
+      if ( (hash != 0) && (whitehash[slot] == hash) )  found = slot + 1;
+     };
+  if (empty == 1) return(1);
+  if (found == 0) return(0);
+
+  eeprom_read_block((void *)stored, (const void *)(EEADDR + (found - 1) * 20), 20);
+  stored[19] = 0x00;
+  whitenormalize(stored, storeddigits);
+  diff = 0;
+  for (i = 0; i < WHITEDIGITS; i++)  diff |= digits[i] ^ storeddigits[i];
+
+return(diff == 0);
+}
+
+// any whitelisted number may control the tracker
+uint8_t whitelisted(const uint8_t *number)
+{
+return(whitematch(number, WHITESLOTS));
+}
+
+// only number stored by ACTIVATE in first entry may change whitelist and configuration,
+// anybody may do it until first ACTIVATE
+uint8_t whiteowner(const uint8_t *number)
+{
+return(whitematch(number, 1));
+}
+
+// process "ALLOW number" and "DENY number" commands in 'smstext' - entries 2...WHITESLOTS can be changed,
+// first entry is changed only by ACTIVATE
+// returns 1 if whitelist was changed
+uint8_t whiteupdate(void)
+{
+  uint8_t *p;
+  uint8_t number[20], digits[WHITEDIGITS];
+  uint8_t slot, free, allow, i;
+  uint16_t hash;
+
+  allow = 1;
+  p = smsparam(ISALLOW, 1);
+  if (p == NULL)
+     {
+      allow = 0;
+      p = smsparam(ISDENY, 1);
+     };
+  if (p == NULL) return(0);
+
+  // copy number parameter
+  memset(number, 0x00, 20);
+  for (i = 0; (i < 19) && (p[i] != ' ') && (p[i] != 0x00); i++)  number[i] = p[i];
+  hash = whitenormalize(number, digits);
+  if (hash == 0) return(0);
+
+  free = 0;
+  for (slot = WHITESLOTS - 1; slot >= 1; slot--)
+     {
+      if (whitehash[slot] == 0)  free = slot;
+      if (whitehash[slot] == hash)
+         {
+          if (allow == 1) return(0);      // already there
+          memset(number, 0xFF, 20);       // erased entry
+          eeprom_write_block((const void *)number, (void *)(EEADDR + slot * 20), 20);
+          whiteload();
+          return(1);
+         };
+     };
+
+  if ( (allow == 0) || (free == 0) ) return(0);
+  eeprom_write_block((const void *)number, (void *)(EEADDR + free * 20), 20);
+  whiteload();
+return(1);
+}
+
+// list all whitelist entries to 'out' buffer as part of SMS - one number per line
+void whitelist(uint8_t *out)
+{
+  uint8_t slot, i, c;
+
+  for (slot = 0; slot < WHITESLOTS; slot++)
+     {
+      if (whitehash[slot] == 0) continue;
+      *out++ = '\n';
+      for (i = 0; i < 19; i++)
+         {
+          c = eeprom_read_byte((const uint8_t *)(EEADDR + slot * 20 + i));
+          if ( (c == 0x00) || (c == 0xFF) ) break;
+          *out++ = c;
+         };
+     };
+  *out = 0x00;
+}
+
+
+
+
+
+// read number stored by ACTIVATE command to 'out' ( 20 bytes ), returns 1 if there is a number
+uint8_t ownernumber(uint8_t *out)
+{
+  eeprom_read_block((void *)out, (const void *)EEADDR, 20);
+  out[19] = 0x00;
+return( (out[0] == '+') || ((out[0] >= '0') && (out[0] <= '9')) );
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// send alarm SMS to number stored by ACTIVATE, 'extra' PROGMEM text is appended if not NULL
+// returns 0 if there is no number activated
+// --------------------------------------------------------------------------------------------------------------------
+uint8_t alarmnotify(const char *extra)
+{
+  uint8_t number[20];
+
+  alarmflag = 0;
+  if (ownernumber(number) == 0)  return(0);
+
+  smsbegin();
+  smsadd_P(ALARM);
+  if (extra != NULL)  smsadd_P(extra);
+  smssend(number);
+return(1);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// send car battery alert SMS with last background voltage to number stored by ACTIVATE
+// returns 0 if there is no number activated
+// --------------------------------------------------------------------------------------------------------------------
+uint8_t carbattnotify(void)
+{
+  uint8_t number[20], volts[8];
+
+  if (ownernumber(number) == 0)  return(0);
+
+  carbatteryvolts(volts, carbattery(adclast, 12));
+  smsbegin();
+  if (carbattstate == CARBATTOK)            smsadd_P(CARBATTFINE);
+  if (carbattstate == CARBATTWEAK)          smsadd_P(CARBATTUNDER);
+  if (carbattstate == CARBATTDISCONNECTED)  smsadd_P(CARBATTDISC);
+  if (carbattstate == CARBATTOVERLOADED)    smsadd_P(CARBATTOVER);
+  smsadd_P(CARBATTREAD);
+  smsadd(volts);
+  smssend(number);
+return(1);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// PREEMPTIBLE WAIT - wait 'seconds' but return at once when STOP command arrives, voice call is rejected
+// SIM7000 stores SMS during the session also in direct mode - other SMS stay unread and are processed after it
+// alarm input and car battery alerts are notified at once and the session goes on
+// returns 1 if STOP was received ( 'stoprequest' is set ), 2 if voice call ended the wait,
+// 3 if alarm input ended the wait, 0 after full wait
+// --------------------------------------------------------------------------------------------------------------------
+uint8_t waitevent(uint16_t seconds)
+{
+  uint32_t deadline;
+  uint8_t found;
+
+  deadline = getuptime() + seconds;
+  while (getuptime() < deadline)
+     {
+      if (stoprequest == 1) return(1);
+      if (alarmflag == 1)
+         {
+          alarmnotify(NULL);
+          return(3);
+         };
+      if ( (carbattalerts == 1) && (carbattmonitor() == 1) )  carbattnotify();
+      // GPRS needs most power - HTTP MODE ends in CRITICAL power profile
+      if ( (continousgps == 254) && (powerprofile == POWERCRITICAL) )  stoprequest = 1;
+      if (conf.ignition != 0)
+         {
+          found = ignitionmonitor();
+          // engine stopped - end tracking started by engine, GUARD MODE is armed after it
+          if ( (found == 2) && (ignitionsession == 1) )  stoprequest = 1;
+          // engine started - end GUARD MODE armed automatically, tracking is started after it
+          if ( (found == 1) && (ignitionsession == 2) )  stoprequest = 1;
+          if (stoprequest == 1) return(1);
+         };
+      // probe serial port for URC
+      if ( !(UCSR0A & (1<<RXC0)) ) continue;
+      readline();
+
+      // reports of this session go to 'phonenumber' - keep it if SMS is not STOP
+      memcpy(smsphonenumber, phonenumber, 20);
+      found = 0;
+      if (strstr_P(response, ISSMS) != NULL)
+         {   // SMS displayed directly - text follows on next line
+          readsmstxt();
+          readsmsphonenumber(0);
+          smsindex = 0;                   // not stored - nothing to delete
+          found = 1;
+         }
+      else if (strstr_P(response, ISINBOX) != NULL)
+         {   // look for STOP among all unread SMS
+          found = readinbox(ISSTOP);
+         }
+      else if (strcmp_P(response, ISRING) == 0)
+         {   // position is being sent anyway - reject the call
+          uart_puts_P(HANGUP);
+          delay_sec(1);
+          return(2);
+         };
+
+      if (found == 1)
+         {
+          if ( (strcasestr_P(smstext, ISSTOP) != NULL) && (whitelisted(phonenumber) == 1) )  stoprequest = 1;
+          else  memcpy(phonenumber, smsphonenumber, 20);
+          // processed SMS is removed from inbox
+          deleteinbox();
+         };
+     };
+
+  if (stoprequest == 1) return(1);
+return(0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// GNSS ACQUISITION - restart policy and histogram of searches in RAM, see GNSSMODES
+//////////////////////////////////////////////////////////////////////////////////
+
+// restart GNSS after power on - warm start if ephemeris of last fix may be still valid
+void gnssrestart(void)
+{
+  if ( (GNSSWARMSEC > 0) && (lastfixtime != 0) && ((getuptime() - lastfixtime) < GNSSWARMSEC) )
+       uart_puts_P(GPSWARMSTART);
+  else uart_puts_P(GPSCLDSTART);
+}
+
+// log fix of search started in 'mode' after 'seconds' with 'sats' satellites used
+void gnsslogfix(uint8_t mode, uint32_t seconds, uint8_t sats)
+{
+  uint8_t bucket;
+
+  bucket = 0;
+  while ( (bucket < GNSSTIMEOUT - 1) && (seconds >= (16UL << bucket)) )  bucket++;
+  gnsslog.bucket[mode][bucket]++;
+  gnsslog.sats[mode] += sats;
+}
+
+// log search started in 'mode' which ended without fix
+void gnsslogtimeout(uint8_t mode)
+{
+  gnsslog.bucket[mode][GNSSTIMEOUT]++;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// Power on GPS and retrieve position from GPS and put it to LOC and LATT buffers by calling 'readSIM7000gps' function
+// returns 1 for new fix, 2 for fresh cached fix ( combined acknowledge ) and 0 if unable to fix
+// --------------------------------------------------------------------------------------------------------------------
+uint8_t readgpsinfo()
+{
+  uint8_t gpsattempts, gpsfixed;   // counter on attempts to get proper GPS position from SIM7000 - for indoor scenarios
+  uint8_t maxattempts;             // search time of this report
+  uint8_t gnssmode;                // start mode of this search for GNSS acquisition histogram
+  uint32_t searchstart, searchtime;
+  gpsattempts = 0;
+  gpsfixed = 0;
+
+
+
+  // if begining/last cycle of continous GPS mode we need to turn on and restart GPS module 
+  // unless GNSS was started already by alarm input and is searching for fix
+  if ( (gnssstarted == 0) && ( (continousgps == 1) || (continousgps == multicount) ) )
+      {   
+           delay_sec(1);
+           uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
+           delay_sec(2);  
+           gnssrestart();              // cold or warm start of SIM7000 GPS
+       }
+  else  // during continous mode cycle - we dont need to turn on and restart GPS module
+       {
+           delay_sec(1); 
+           // hot start of SIM7000 GPS if needed, otherwise simply poll GPS data
+           // uart_puts_P(GPSHOTSTART);   
+       }; 
+  gnssstarted = 0;
+
+  // combined acknowledge - fix taken few moments ago is still in LAT & LONG of fix, report it at once
+  // unless it was overwritten by estimated position
+  if ( (ackpending == 1) && (lastfixtime != 0) && ((getuptime() - lastfixtime) <= CACHEDFIXSEC) && (fix.measured == 1) )
+       {
+           if (continousgps == 1)         // ... if last GPS cycle or single sequence
+              {  uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS power to save battery
+                 delay_sec(1);  
+              }; 
+           return(2);
+       };
+  gnsssearches++;
+  // search without fix since GNSS power on is counted from power on, otherwise GNSS is already running
+  searchstart = getuptime();
+  if (ttffstart != 0)
+     {
+      gnssmode = gnssstartmode;
+      searchstart = ttffstart;
+     }
+  else gnssmode = GNSSHOT;
+
+  // full search only if there is no fix to estimate from - otherwise report estimate after short search
+  // ( not in GUARD MODE, it reports only measured positions )
+  maxattempts = GPSATTEMPTS >> powerprofile;
+  if ( (continousgps != 255) && (lastfixtime != 0) && (maxattempts > DRATTEMPTS) &&
+       ((getuptime() - lastfixtime) + DRATTEMPTS * 15 <= DRMAXSEC) )  maxattempts = DRATTEMPTS;
+      
+
+
+  // now we have to wait some time until SIM7000 gets GPS signal, assume we are waiting 10 minutes 
+  // check the status in 30 sec intervals and then quit
+  do 
+  {
+          // in NOT in GUARD mode - wait 15 sec for first fix checking, STOP command ends searching at once
+          if ( (continousgps != 255) && (waitevent(15) == 1) )  break;
+
+          uart_puts_P(GPSINFO);   // check GPS status
+
+          if (readline()>0)       // check GPS status response if NOT FIXED
+           {
+                    gpsfixed = 0;
+
+                    // check if already fixed for GPS coordinates ?
+                    if (is_in_rx_buffer_P(response, GPSISFIXED, BUFFER_SIZE) == 1) 
+                          {
+                           // when CGNSINF: 1,1 - stop checking GPS anymore
+                            gpsfixed = 1; 
+                          }; 
+
+                      
+                    // special treatment for GUARD MODE - if not fix quit immediatelly, because there will be repeatition in 1 min
+                    if ( (gpsfixed == 0) && (continousgps == 255) )  return (0);       
+			             			  
+                    // there was some fix - 3D or 2D, poll the data from GPS
+                    if ( gpsfixed == 1)        
+                      { 
+                       gnssfixes++;
+                       searchtime = getuptime() - searchstart;
+                       // time to first fix since GNSS power on
+                       if (ttffstart != 0)
+                          {
+                           ttfflast = searchtime;
+                           ttffsum += ttfflast;
+                           ttffcount++;
+                           ttffstart = 0;
+                          };
+
+                        readSIM7000gps();         // poll GPS position and parse to LAT & LONG of fix
+                        gnsslogfix(gnssmode, searchtime, satsused);
+                        delay_sec(2); 
+
+                        if (continousgps == 1)         // ... if last GPS cycle or single sequence
+                           {  uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS power to save battery
+                              delay_sec(1);  
+                      }; 
+                        return(1);               // succesful GPS position decoding from SIM7000  
+                       }                         // end of second IF               
+                    else   gpsattempts++;        // if not fixed just increase attempts counter
+
+                    // combined acknowledge - no fix within deadline so send acknowledge now
+                    if ( (ackpending == 1) && (gpsattempts == ACKATTEMPTS) )
+                      {
+                        ackpending = 0;
+                        sendack(ackmsg);
+                      };
+            };                                   // end of first IF       
+     
+    } while (gpsattempts < maxattempts); // end of DO loop - only 20 attempts in 15 sec intervals to get GPS fixation - 5 minutes of searching, less in SAVER and CRITICAL profile or with estimate
+
+    // search ended by STOP command or shortened for estimate is not a timeout
+    if (gpsattempts >= (GPSATTEMPTS >> powerprofile))  gnsslogtimeout(gnssmode);
+
+    // GPS position retrieval not succesful - we are disabling GPS/GNSS power 
+    delay_sec(2); 
+    if (continousgps == 1)         // ... if last GPS cycle or single sequence
+       {  uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS power to save battery
+          delay_sec(1);  
+        }; 
+
+return(0); // 0 means that GPS was unable to fix on sattelites at all
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// delay procedure ASM based because _delay_ms() is working bad for 1 MHz clock MCU
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// delay partucular number of seconds 
+
+void delay_sec(uint8_t i)
+{
+while(i > 0)
+{
+// Delay 1 000 000 cycles
+// 1s at 1 MHz
+
+asm volatile (
+    "    ldi  r18, 6"           "\n"
+    "    ldi  r19, 19"           "\n"
+    "    ldi  r20, 174"           "\n"
+    "1:  dec  r20"           "\n"
+    "    brne 1b"           "\n"
+    "    dec  r19"           "\n"
+    "    brne 1b"           "\n"
+    "    dec  r18"           "\n"
+    "    brne 1b"           "\n"
+    "    rjmp 1f"           "\n"
+    "1:"           "\n"
+);
+
+i--;  // decrease another second
+
+};    // repeat until i not zero
+
+}
+
+// 
+// delay multiplication of 50 microseconds
+//
+
+void delay_50usec()
+{
+// Generated by delay loop calculator
+// at http://www.bretmulvey.com/avrdelay.html
+// Delay 50 cycles
+// 50us at 1 MHz
+
+asm volatile (
+    "    ldi  r18, 16"	"\n"
+    "1:  dec  r18"	"\n"
+    "    brne 1b"	"\n"
+    "    rjmp 1f"	"\n"
+    "1:"	"\n"
+);
+
+
+}
+
+
+
+
+
+// ------------------------------------------------------------------------------------------------------------
+// DEAD RECKONING - when GNSS is unable to fix project position of last good fix using its speed and course
+// result is put to 'fix.latitude' and 'fix.longtitude' buffers, only for DRMAXSEC seconds after last good fix
+// ------------------------------------------------------------------------------------------------------------
+// cosine of whole 'degrees' * 1024
+int16_t icos(uint16_t degrees)
+{
+  uint16_t low, high;
+  uint8_t negative;
+
+  degrees %= 360;
+  if (degrees > 180) degrees = 360 - degrees;     // cosine is even
+  negative = 0;
+  if (degrees > 90)
+     {
+      degrees = 180 - degrees;
+      negative = 1;
+     };
+  low = pgm_read_word(&COSTABLE[degrees / 5]);
+  high = pgm_read_word(&COSTABLE[(degrees + 4) / 5]);
+  low -= ((low - high) * (degrees % 5)) / 5;
+  if (negative == 1) return(-(int16_t)low);
+return(low);
+}
+
+// write 'value' in microdegrees as "-dd.dddddd" to 'out' buffer - the same format as SIM7000 does
+void degreestring(uint8_t *out, int32_t value)
+{
+  uint32_t fraction;
+  uint8_t i;
+
+  if (value < 0)
+     {
+      *out++ = '-';
+      value = -value;
+     };
+  ultoa(value / 1000000L, out, 10);
+  out += strlen(out);
+  *out++ = '.';
+  fraction = value % 1000000L;
+  for (i = 6; i > 0; i--)
+     {
+      out[i - 1] = '0' + fraction % 10;
+      fraction /= 10;
+     };
+  out[6] = 0x00;
+}
+
+// project last good fix forward to now into 'lat' & 'lon' in microdegrees, returns 0 and leaves them
+// untouched when there is no fix or it is older than DRMAXSEC
+uint8_t drproject(int32_t *latitude, int32_t *longtitude)
+{
+  uint32_t elapsed;
+  int32_t distance, lat, lon;
+  int16_t coslat;
+
+  // no good fix so far - nothing to project
+  if (lastfixtime == 0) return(0);
+
+  // last fix too old - estimation would be useless
+  elapsed = getuptime() - lastfixtime;
+  if (elapsed > DRMAXSEC) return(0);
+
+  // distance in meters travelled since last fix, speed from GNSS is in km/h
+  // below DRMINSPEED vehicle is standing and speed/course are only GNSS noise
+  distance = 0;
+  if (lastfixspeed >= DRMINSPEED * 10) distance = (uint32_t)lastfixspeed * elapsed / 36;
+  if (distance > DRMAXDIST) distance = DRMAXDIST;
+
+  // one degree of latitude is ~111320 meters ( 8.98 microdegrees per meter ),
+  // degree of longtitude shrinks with cos(latitude) - integer math, no floating point library
+  lat = ((distance * icos(lastfixcourse)) / 1024) * 449 / 50;
+  lon = ((distance * icos(lastfixcourse + 270)) / 1024) * 449 / 50;
+  coslat = icos((lastfixlat < 0 ? -lastfixlat : lastfixlat) / 1000000L);
+  if (coslat < 8) coslat = 8;                       // ~89.5 degrees - do not divide by zero near the pole
+  lon = lon * 1024 / coslat;
+  lat += lastfixlat;
+  lon += lastfixlong;
+  if (lat > 90000000L)    lat = 90000000L;
+  if (lat < -90000000L)   lat = -90000000L;
+  if (lon > 180000000L)   lon -= 360000000L;
+  if (lon < -180000000L)  lon += 360000000L;
+
+  *latitude = lat;
+  *longtitude = lon;
+
+return(1);
+}
+
+uint8_t deadreckoning()
+{
+  int32_t lat, lon;
+
+  if (drproject(&lat, &lon) == 0) return(0);
+
+  degreestring(fix.latitude, lat);
+  degreestring(fix.longtitude, lon);
+  fix.measured = 0;
+
+return(1);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// SOFT RTC - seeded from GNSS UTC or network time and advanced by the timebase
+// every GNSS fix resynchronizes it and measures drift of the MCU clock
+//////////////////////////////////////////////////////////////////////////////////
+
+// convert two ASCII digits to number
+uint8_t twodigits(const uint8_t *s)
+{
+  return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+// convert UTC date and time ( years 2000-2099 ) to seconds since 2000-01-01 00:00:00
+uint32_t rtcmktime(uint8_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+  uint16_t days;
+  uint8_t i;
+
+  days = day - 1;
+  for (i = 0; i < year; i++)        days += ((i & 3) == 0) ? 366 : 365;
+  for (i = 1; i < month; i++)       days += pgm_read_byte(&MONTHDAYS[i-1]);
+  if ( (month > 2) && ((year & 3) == 0) )  days++;      // 29th of February in leap year
+
+  return ((uint32_t)days * 86400UL) + ((uint32_t)hour * 3600UL) + ((uint16_t)minute * 60) + second;
+}
+
+// current UTC time from SOFT RTC with drift correction, 0 if RTC was never set
+uint32_t rtcnow(void)
+{
+  uint32_t elapsed;
+  int32_t correction;
+
+  if (rtcsource == 0) return(0);
+
+  // split elapsed time not to overflow 32-bit arithmetic when there was no sync for weeks
+  elapsed = getuptime() - rtcbaseuptime;
+  correction = ((int32_t)(elapsed / 1000) * rtcdrift) / 1000 + ((int32_t)(elapsed % 1000) * rtcdrift) / 1000000L;
+
+  return rtcbase + elapsed + correction;
+}
+
+// set SOFT RTC to given UTC time, measure drift of the timebase between GNSS synchronizations
+void rtcset(uint32_t utc, uint8_t source)
+{
+  uint32_t now, elapsed;
+  int32_t error, ppm;
+
+  // network time may only seed the clock, it never overrides GNSS time
+  if ( (source == 1) && (rtcsource == 2) ) return;
+
+  now = getuptime();
+
+  if (source == 2)
+     {
+      if (rtcsource != 2)
+         {   // first GNSS synchronization becomes reference for drift measurement
+          rtcrefutc = utc;
+          rtcrefuptime = now;
+         }
+      else
+         {
+          elapsed = now - rtcrefuptime;
+          // drift can be measured only between GNSS synchronizations far enough from each other
+          if (elapsed >= RTCMINDRIFT)
+             {
+              // how many seconds the timebase lost (+) or gained (-) since reference synchronization
+              error = (int32_t)(utc - rtcrefutc) - (int32_t)elapsed;
+              // error is scaled down together with elapsed time so error * 1000000 fits 32 bits
+              while ( (error > 2000) || (error < -2000) )
+                 {
+                  error /= 2;
+                  elapsed /= 2;
+                 };
+              if (elapsed == 0) elapsed = 1;
+              ppm = error * 1000000L / (int32_t)elapsed;
+              if (ppm > RTCMAXDRIFT)  ppm = RTCMAXDRIFT;
+              if (ppm < -RTCMAXDRIFT) ppm = -RTCMAXDRIFT;
+              // smooth next measurements - single fix may be reported a second late
+              if (rtcdrift == 0)  rtcdrift = ppm;
+              else                rtcdrift = (rtcdrift * 3 + ppm) / 4;
+              rtcrefutc = utc;
+              rtcrefuptime = now;
+             };
+         };
+     };
+
+  rtcbase = utc;
+  rtcbaseuptime = now;
+  rtcsource = source;
+}
+
+// synchronize SOFT RTC with GNSS UTC time from AT+CGNSINF - format yyyyMMddhhmmss.sss
+void rtcsyncgnss(const uint8_t *utc)
+{
+  // GNSS may report empty time field or year 1980 before first almanac
+  if ( (utc[0] != '2') || (utc[1] != '0') ) return;
+
+  rtcset(rtcmktime(twodigits(utc+2), twodigits(utc+4), twodigits(utc+6),
+                   twodigits(utc+8), twodigits(utc+10), twodigits(utc+12)), 2);
+}
+
+// write SOFT RTC time to buffer in the same format as GNSS does - yyyyMMddhhmmss
+void rtcformat(uint8_t *s)
+{
+  uint32_t t;
+  uint16_t days, daysinyear;
+  uint8_t year, month, daysinmonth, hour, minute, second;
+
+  t = rtcnow();
+  second = t % 60;  t /= 60;
+  minute = t % 60;  t /= 60;
+  hour   = t % 24;
+  days   = t / 24;
+
+  // count full years and months from 2000-01-01
+  year = 0;
+  while (1) {
+      daysinyear = ((year & 3) == 0) ? 366 : 365;
+      if (days < daysinyear) break;
+      days -= daysinyear;
+      year++;
+     };
+  month = 1;
+  while (1) {
+      daysinmonth = pgm_read_byte(&MONTHDAYS[month-1]);
+      if ( (month == 2) && ((year & 3) == 0) ) daysinmonth++;
+      if (days < daysinmonth) break;
+      days -= daysinmonth;
+      month++;
+     };
+
+  s[0] = '2';  s[1] = '0';
+  s[2] = '0' + year / 10;    s[3] = '0' + year % 10;
+  s[4] = '0' + month / 10;   s[5] = '0' + month % 10;
+  s[6] = '0' + (days+1) / 10;  s[7] = '0' + (days+1) % 10;
+  s[8] = '0' + hour / 10;    s[9] = '0' + hour % 10;
+  s[10] = '0' + minute / 10; s[11] = '0' + minute % 10;
+  s[12] = '0' + second / 10; s[13] = '0' + second % 10;
+  s[14] = 0x00;
+}
+
+// -------------------------------------------------------------------------------
+// seed SOFT RTC from network time ( NITZ ) - AT+CCLK? gives "yy/MM/dd,hh:mm:ss+zz" 
+// where zz is local time zone in quarters of hour
+// -------------------------------------------------------------------------------
+uint8_t readclock()
+{
+  uint8_t *p;
+  int32_t utc;
+  int8_t zone;
+
+  // GNSS time is better, do not ask modem
+  if (rtcsource == 2) return(1);
+
+  uart_puts_P(READCLOCK);
+  if (readline()>0)
+     {
+      if (is_in_rx_buffer_P(response, ISCLOCK, BUFFER_SIZE) == 1)
+         {
+          // find beginning of the date just after quotation mark
+          p = strchr(response, '\"');
+          if (p == NULL) return(0);
+          p++;
+          // without NITZ SIM7000 starts from year 1980 or 2004 - ignore such time
+          if (twodigits(p) < 20) return(0);
+
+          utc = rtcmktime(twodigits(p), twodigits(p+3), twodigits(p+6),
+                          twodigits(p+9), twodigits(p+12), twodigits(p+15));
+          // remove time zone to get UTC
+          zone = twodigits(p+18);
+          if (p[17] == '-') zone = -zone;
+          utc = utc - (int32_t)zone * 900L;
+
+          rtcset(utc, 1);
+          return(1);
+         };
+     };
+
+return(0);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// SHORT LOCATION CODE - geohash of fix.latitude & fix.longtitude in integer arithmetic
+//////////////////////////////////////////////////////////////////////////////////
+
+// convert decimal degrees string "-12.345678" to millionths of degree without floating point
+int32_t microdegrees(const uint8_t *s)
+{
+  int32_t value;
+  uint8_t negative, decimals;
+
+  value = 0;
+  negative = 0;
+  decimals = 0;
+
+  if (*s == '-') { negative = 1; s++; };
+  while (*s != 0x00)
+     {
+      if (*s == '.')  decimals = 1;
+      else if ( (*s >= '0') && (*s <= '9') && (decimals < 7) )
+         {
+          value = value * 10 + (*s - '0');
+          if (decimals > 0) decimals++;
+         }
+      else break;
+      s++;
+     };
+  // pad missing decimal places up to 6
+  if (decimals == 0) decimals = 1;
+  while (decimals < 7) { value = value * 10; decimals++; };
+
+  if (negative == 1) return(-value);
+return(value);
+}
+
+// number of geohash characters for HDOP of the fix - cells of 9 characters are ~5 m, 8 ~ 20 m, 7 ~ 150 m, 6 ~ 600 m
+// estimated positions get 7 characters as error of dead reckoning grows quickly
+uint8_t geohashlength(void)
+{
+  uint16_t tenths;
+
+  if (estimated == 1) return(7);
+
+  // HDOP is "1.2" - convert to tenths
+  tenths = microdegrees(fix.hdop) / 100000L;
+  if (tenths == 0)   return(8);      // HDOP not known
+  if (tenths <= 10)  return(9);
+  if (tenths <= 40)  return(8);
+  if (tenths <= 150) return(7);
+return(6);
+}
+
+// encode position in microdegrees to 'geohash' buffer, bits alternate longtitude and latitude
+// each bit halves the interval - computed exactly as binary fraction of offset from south / west edge
+void geohashfrom(int32_t lat, int32_t lon, uint8_t length)
+{
+  uint8_t pos, bit, index, even;
+
+  lat += 90000000L;       // 0 ... 180 000 000
+  lon += 180000000L;      // 0 ... 360 000 000
+  even = 1;
+
+  for (pos = 0; pos < length; pos++)
+     {
+      index = 0;
+      for (bit = 0; bit < 5; bit++)
+         {
+          index <<= 1;
+          if (even == 1)
+             {   // longtitude bit
+              lon <<= 1;
+              if (lon >= 360000000L) { index |= 1; lon -= 360000000L; };
+             }
+          else
+             {   // latitude bit
+              lat <<= 1;
+              if (lat >= 180000000L) { index |= 1; lat -= 180000000L; };
+             };
+          even ^= 1;
+         };
+      geohash[pos] = pgm_read_byte(&GEOHASH32[index]);
+     };
+  geohash[length] = 0x00;
+}
+
+// encode fix.latitude & fix.longtitude of current report
+void geohashencode(void)
+{
+  geohashfrom(microdegrees(fix.latitude), microdegrees(fix.longtitude), geohashlength());
+}
+
+
+// how many characters of packed positions fit into one message - concatenated PDU SMS carry more,
+// queued SMS in front of them leave less room
+uint16_t packlimit(void)
+{
+  uint16_t limit;
+
+  limit = (smspdu == 1) ? PACKSIZE : PACKTEXT;
+  if (smsqueue_len + PACKROOM >= SMSQUEUESIZE)  return(0);
+  if (limit > SMSQUEUESIZE - PACKROOM - smsqueue_len)  limit = SMSQUEUESIZE - PACKROOM - smsqueue_len;
+return(limit);
+}
+
+// ------------------------------------------------------------------------------------------------------------
+// COMBINED ACKNOWLEDGE - append current position as "hhmmss lat,lon" line to 'packsms' buffer
+// estimated position is marked with '*' at the end of line
+// ------------------------------------------------------------------------------------------------------------
+void packposition(void)
+{
+  uint8_t *packsms;
+  uint8_t len;
+
+  if (shortloc == 1)
+     {
+      geohashencode();
+      len = strlen(geohash) + 9;
+     }
+  else len = strlen(fix.latitude) + strlen(fix.longtitude) + 10;
+  if (packsms_pos + len > packlimit()) return;
+  packsms = packtext();
+
+  // GNSS time is yyyyMMddhhmmss - only hhmmss is useful in one SMS
+  if (strlen(fix.utctime) >= 14)  memcpy(&packsms[packsms_pos], &fix.utctime[8], 6);
+  else                           memset(&packsms[packsms_pos], '0', 6);
+  packsms_pos += 6;
+  packsms[packsms_pos++] = ' ';
+
+  if (shortloc == 1)
+     {   // position as geohash
+      strcpy(&packsms[packsms_pos], geohash);
+      packsms_pos += strlen(geohash);
+     }
+  else
+     {
+      strcpy(&packsms[packsms_pos], fix.latitude);
+      packsms_pos += strlen(fix.latitude);
+      packsms[packsms_pos++] = ',';
+      strcpy(&packsms[packsms_pos], fix.longtitude);
+      packsms_pos += strlen(fix.longtitude);
+     };
+  if (estimated == 1)  packsms[packsms_pos++] = '*';
+  packsms[packsms_pos++] = '\n';
+  packsms[packsms_pos] = 0x00;
+}
+
+// send SMS with packed MULTI positions and battery voltage to 'phonenumber'
+void sendpacked(void)
+{
+    delay_sec(1); 
+    smsbegin();
+    smsadd(packtext());            // positions line by line
+    smsadd_P(BATT);                // send BATTERY VOLTAGE in milivolts
+    smsadd(battery);               // from buffer
+    smssend(phonenumber);
+
+    packsms_pos = 0;
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// end MULTI, GUARD or HTTP mode after STOP command - send packed positions, acknowledge and power off GNSS
+// --------------------------------------------------------------------------------------------------------------------
+void stopreport(void)
+{
+    stoprequest = 0;
+    continousgps = 0; 
+
+    // positions packed so far are not lost
+    if (packsms_pos > 0) sendpacked();
+
+    // send a SMS configrmation of the command
+    sendack(STOP);
+    // delete read SMSes and SMS confirmation - commands stored during the session are processed after it
+    uart_puts_P(SMS1);
+    delay_sec(1); 
+    uart_puts_P(DELSMSREAD);
+    delay_sec(2);
+    // disable GPS to conserve power after quitting MULTI, GUARD or HTTP MODE
+    uart_puts_P(GPSPWROFF);
+    delay_sec(1);   
+    //and close the IP bearer for Internet connectivity 
+    uart_puts_P(SAPBRCLOSE);
+    delay_sec(5);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// CONFIGURATION - versioned block in EEPROM protected by CRC, changed by SET command
+//////////////////////////////////////////////////////////////////////////////////
+
+// CRC of configuration block in EEPROM
+uint16_t eecrc(uint16_t address, uint8_t size)
+{
+  uint16_t crc;
+  uint8_t i;
+
+  crc = 0xFFFF;
+  for (i = 0; i < size; i++)
+     crc = _crc16_update(crc, eeprom_read_byte((const uint8_t *)(address + i)));
+return(crc);
+}
+
+uint16_t confcrc(void)
+{
+return(eecrc(EECONFADDR, offsetof(struct confblock, crc)));
+}
+
+// write string parameter from RAM to configuration block at 'offset', 'size' includes end of string
+void confstring(uint8_t offset, uint8_t size, const char *value)
+{
+  uint8_t i;
+
+  for (i = 0; i < size - 1; i++)
+     {
+      if (value[i] == 0x00) break;
+      eeprom_update_byte((uint8_t *)(EECONFADDR + offset + i), value[i]);
+     };
+  eeprom_update_byte((uint8_t *)(EECONFADDR + offset + i), 0x00);
+}
+
+// write default string from PROGMEM to configuration block - same as confstring()
+void confstring_P(uint8_t offset, uint8_t size, const char *value)
+{
+  uint8_t i;
+
+  for (i = 0; i < size - 1; i++)
+     {
+      if (pgm_read_byte(&value[i]) == 0x00) break;
+      eeprom_update_byte((uint8_t *)(EECONFADDR + offset + i), pgm_read_byte(&value[i]));
+     };
+  eeprom_update_byte((uint8_t *)(EECONFADDR + offset + i), 0x00);
+}
+
+// write numbers from RAM to configuration block and seal it with CRC
+void confsave(void)
+{
+  conf.version = CONFVERSION;
+  eeprom_update_block((const void *)&conf, (void *)EECONFADDR, sizeof(conf));
+  eeprom_update_word((uint16_t *)(EECONFADDR + offsetof(struct confblock, crc)), confcrc());
+}
 
-          if (readline()>0)       // check GPS status response if NOT FIXED
-           {
-                    gpsfixed = 0;
+// read configuration from EEPROM, default one is written when there is no valid block of this version
+void confload(void)
+{
+  uint8_t i;
 
-                    // check if already fixed for GPS coordinates ?
-                    memcpy_P(buf, GPSISFIXED, sizeof(GPSISFIXED));   
-                    if (is_in_rx_buffer(response, buf, BUFFER_SIZE ) == 1) 
-                          {
-                           // when CGNSINF: 1,1 - stop checking GPS anymore
-                            gpsfixed = 1; 
-                          }; 
+  eeprom_read_block((void *)&conf, (const void *)EECONFADDR, sizeof(conf));
+  if ( (conf.version == CONFVERSION) &&
+       (eeprom_read_word((const uint16_t *)(EECONFADDR + offsetof(struct confblock, crc))) == confcrc()) )  return;
+
+  conf.guard = GUARDDISTANCE;
+  conf.guardinterval = GUARDINTERVAL;
+  conf.multicount = MULTICOUNT;
+  conf.multiinterval = MULTIINTERVAL;
+  conf.httpinterval = HTTPINTERVAL;
+  conf.ignition = 0;
+  conf.ignitionoff = IGNITIONOFF;
+  conf.autoguard = 0;
+  for (i = 0; i < ENERGYSTATES; i++)  conf.current[i] = pgm_read_word(&ENERGYCURRENT[i]);
+  confstring_P(offsetof(struct confblock, pin), sizeof(((struct confblock *)0)->pin), CONFPIN);
+  confstring_P(offsetof(struct confblock, apn), sizeof(((struct confblock *)0)->apn), CONFAPN);
+  confstring_P(offsetof(struct confblock, user), sizeof(((struct confblock *)0)->user), CONFUSER);
+  confstring_P(offsetof(struct confblock, pwd), sizeof(((struct confblock *)0)->pwd), CONFPWD);
+  confstring_P(offsetof(struct confblock, url), sizeof(((struct confblock *)0)->url), CONFURL);
+  confsave();
+}
 
-                      
-                    // special treatment for GUARD MODE - if not fix quit immediatelly, because there will be repeatition in 1 min
-                    if ( (gpsfixed == 0) && (continousgps == 255) )  return (0);       
-			             			  
-                    // there was some fix - 3D or 2D, poll the data from GPS
-                    if ( gpsfixed == 1)        
-                      { 
+// send string parameter from configuration block at 'offset' to UART
+void confputs(uint8_t offset)
+{
+  uint8_t c;
 
-                       // initialize buffers with zero characters first before reading new values from SIM7000 GNSS
-                        memcpy_P(latitudegps, INITLOC, sizeof(INITLOC));
-                        memcpy_P(longtitudegps, INITLOC, sizeof(INITLOC));
-                        memcpy_P(utctimegps, INITLOC, sizeof(INITLOC));
-						
-                        readSIM7000gps();         // poll GPS position and parse to buffers LAT & LONG
-                        delay_sec(2); 
+  while (1)
+     {
+      c = eeprom_read_byte((const uint8_t *)(EECONFADDR + offset));
+      if ( (c == 0x00) || (c == 0xFF) ) break;
+      send_uart(c);
+      offset++;
+     };
+}
 
-                        if (continousgps == 1)         // ... if last GPS cycle or single sequence
-                           {  uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS power to save battery
-                              delay_sec(1);  
-                      }; 
-                        return(1);               // succesful GPS position decoding from SIM7000  
-                       }                         // end of second IF               
-                    else   gpsattempts++;        // if not fixed just increase attempts counter
-            };                                   // end of first IF       
-     
-    } while (gpsattempts<20); // end of DO loop - only 20 attempts in 15 sec intervals to get GPS fixation - 5 minutes of searching
+// wait for final result of AT command - returns 1 for OK, 0 for ERROR or timeout
+uint8_t atresult(uint8_t seconds)
+{
+  uint32_t deadline;
 
-    // GPS position retrieval not succesful - we are disabling GPS/GNSS power 
-    delay_sec(2); 
-    if (continousgps == 1)         // ... if last GPS cycle or single sequence
-       {  uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS power to save battery
-          delay_sec(1);  
-        }; 
+  deadline = getuptime() + seconds;
+  while (1)
+     {
+      while ( !(UCSR0A & (1<<RXC0)) )
+         {
+          if (getuptime() >= deadline) return(0);
+         };
+      readline();
+      if (strcmp_P(response, ISOK) == 0)  return(1);
+      if (strstr_P(response, ISERROR) != NULL)  return(0);
+     };
+}
 
-return(0); // 0 means that GPS was unable to fix on sattelites at all
+// remaining attempts of SIM PIN1, 0 when SIM7000 does not tell
+uint8_t pinretries(void)
+{
+  uint8_t retries;
+
+  retries = 0;
+  uart_puts_P(SHOW_RETRIES);
+  readline();
+  if (strstr_P(response, ISSPIC) != NULL)
+     {
+      retries = atoi(strchr(response, ':') + 1);
+      atresult(1);
+     };
+return(retries);
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// delay procedure ASM based because _delay_ms() is working bad for 1 MHz clock MCU
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// check new PIN against SIM before it is stored - SIM waiting for PIN is unlocked by it,
+// unlocked SIM verifies it by AT+CPWD changing PIN to the same value, only when SIM has all
+// PINMINRETRIES attempts left, returns 1 if SIM accepted it
+uint8_t pinverify(const uint8_t *pin)
+{
+  uint8_t i;
 
-// delay partucular number of seconds 
+  // 4 to 8 digits only
+  for (i = 0; pin[i] != 0x00; i++)
+     {
+      if ( (pin[i] < '0') || (pin[i] > '9') )  return(0);
+     };
+  if ( (i < 4) || (i > 8) )  return(0);
 
-void delay_sec(uint8_t i)
+  // wrong PIN takes one SIM attempt - never try it when SIM could end up waiting for PUK
+  if (pinretries() < PINMINRETRIES)  return(0);
+
+  uart_puts_P(SHOW_PIN);
+  readline();
+  if (is_in_rx_buffer_P(response, PIN_MUST_BE_ENTERED, BUFFER_SIZE) == 1)
+     {
+      // PIN of this boot was not accepted, new one is the only attempt until reset
+      if (pinsent == 1)  return(0);
+      atresult(1);
+      pinsent = 1;
+      uart_puts_P(ENTER_PIN);
+      uart_puts(pin);
+      uart_puts_P(QUOTECR);
+      return(atresult(5));
+     };
+  if (is_in_rx_buffer_P(response, PIN_IS_READY, BUFFER_SIZE) == 0)  return(0);
+  atresult(1);
+  uart_puts_P(VERIFY_PIN);
+  uart_puts(pin);
+  uart_puts_P(QUOTECOMMA);
+  uart_puts(pin);
+  uart_puts_P(QUOTECR);
+return(atresult(5));
+}
+
+// string parameter is passed inside quotes of AT commands - quote, command separator
+// and control characters would let it inject its own AT command, returns 1 if safe
+uint8_t confsafe(const uint8_t *value)
 {
-while(i > 0)
+  for (; *value != 0x00; value++)
+     {
+      if ( (*value == '"') || (*value == ';') || (*value < 0x20) || (*value == 0x7F) )  return(0);
+     };
+return(1);
+}
+
+// process "SET parameter value" command in 'smstext' - text is not converted to upper case yet
+// because APN, password and URL are case sensitive
+// returns 1 if configuration was changed
+uint8_t confupdate(void)
 {
-// Delay 1 000 000 cycles
-// 1s at 1 MHz
+  uint8_t *p, *value;
+  char *end;
+  uint32_t parsed;
+  uint16_t number;
+  uint8_t offset, size, i;
+
+  // parameter name after SET
+  p = smstext + strlen_P(ISSET);
+  while (*p == ' ') p++;
+  value = p;
+  while ( (*value != ' ') && (*value != 0x00) ) value++;
+  while (*value == ' ') value++;
+  if (*value == 0x00) return(0);
+  // value ends with space or end of SMS
+  for (i = 0; (value[i] != ' ') && (value[i] != 0x00); i++);
+  value[i] = 0x00;
+
+  // string parameters
+  offset = 0;
+  if      (strncasecmp_P(p, SETPIN, sizeof(SETPIN) - 1) == 0)    { offset = offsetof(struct confblock, pin);  size = sizeof(((struct confblock *)0)->pin); }
+  else if (strncasecmp_P(p, SETAPN, sizeof(SETAPN) - 1) == 0)    { offset = offsetof(struct confblock, apn);  size = sizeof(((struct confblock *)0)->apn); }
+  else if (strncasecmp_P(p, SETUSER, sizeof(SETUSER) - 1) == 0)  { offset = offsetof(struct confblock, user); size = sizeof(((struct confblock *)0)->user); }
+  else if (strncasecmp_P(p, SETPWD, sizeof(SETPWD) - 1) == 0)    { offset = offsetof(struct confblock, pwd);  size = sizeof(((struct confblock *)0)->pwd); }
+  else if (strncasecmp_P(p, SETURL, sizeof(SETURL) - 1) == 0)    { offset = offsetof(struct confblock, url);  size = sizeof(((struct confblock *)0)->url); };
+  if (offset != 0)
+     {
+      // "-" clears optional string, PIN cannot be cleared
+      if (offset == offsetof(struct confblock, pin))
+         {
+          if (pinverify(value) == 0)  return(0);
+         }
+      else
+         {
+          if (strcmp(value, "-") == 0) value[0] = 0x00;
+          if (confsafe(value) == 0)  return(0);
+         };
+      confstring(offset, size, value);
+      confsave();
+      return(1);
+     };
+
+  // numeric parameters - only digits, int of AVR is 16-bit so value is parsed to 32 bits and
+  // checked before it is narrowed, "SET GUARD 70000" must not wrap into the valid range
+  if ( (*value < '0') || (*value > '9') )  return(0);
+  parsed = strtoul(value, &end, 10);
+  if ( (*end != 0x00) || (parsed > 65535UL) )  return(0);
+  number = parsed;
+
+  // GUARDINT must be checked before GUARD
+  if      ( (strncasecmp_P(p, SETGUARDINT, sizeof(SETGUARDINT) - 1) == 0) && (number >= MININTERVAL) && (number <= MAXINTERVAL) )  conf.guardinterval = number;
+  else if ( (strncasecmp_P(p, SETGUARD, sizeof(SETGUARD) - 1) == 0) && (number >= 50) && (number <= 50000) )                     conf.guard = number;
+  else if ( (strncasecmp_P(p, SETCOUNT, sizeof(SETCOUNT) - 1) == 0) && (number >= 1) && (number <= MULTIMAX) )                   conf.multicount = number;
+  else if ( (strncasecmp_P(p, SETMULTI, sizeof(SETMULTI) - 1) == 0) && (number >= MININTERVAL) && (number <= MAXINTERVAL) )      conf.multiinterval = number;
+  else if ( (strncasecmp_P(p, SETHTTP, sizeof(SETHTTP) - 1) == 0) && (number >= MININTERVAL) && (number <= MAXINTERVAL) )        conf.httpinterval = number;
+  else if ( (strncasecmp_P(p, SETIGNITION, sizeof(SETIGNITION) - 1) == 0) && (number <= 2) )                                     conf.ignition = number;
+  else if ( (strncasecmp_P(p, SETIGNOFF, sizeof(SETIGNOFF) - 1) == 0) && (number >= MININTERVAL) && (number <= MAXINTERVAL) )    conf.ignitionoff = number;
+  else if ( (strncasecmp_P(p, SETAUTOGUARD, sizeof(SETAUTOGUARD) - 1) == 0) && (number <= 1) )                                   conf.autoguard = number;
+  else if ( (strncasecmp_P(p, SETMA, sizeof(SETMA) - 1) == 0) && ((i = energystate(p + sizeof(SETMA) - 1)) < ENERGYSTATES) && (number <= 5000) )  conf.current[i] = number;
+  else return(0);
+
+  confsave();
+return(1);
+}
 
-asm volatile (
-    "    ldi  r18, 6"           "\n"
-    "    ldi  r19, 19"           "\n"
-    "    ldi  r20, 174"           "\n"
-    "1:  dec  r20"           "\n"
-    "    brne 1b"           "\n"
-    "    dec  r19"           "\n"
-    "    brne 1b"           "\n"
-    "    dec  r18"           "\n"
-    "    brne 1b"           "\n"
-    "    rjmp 1f"           "\n"
-    "1:"           "\n"
-);
+// append "\nname value" to 'out' buffer, returns pointer to end of string
+uint8_t *confline(uint8_t *out, const char *name, uint16_t value)
+{
+  *out++ = '\n';
+  strcpy_P(out, name);
+  out += strlen(out);
+  *out++ = ' ';
+  utoa(value, out, 10);
+return(out + strlen(out));
+}
 
-i--;  // decrease another second
+// list configuration to 'out' buffer as part of SMS - PIN and APN password are not shown
+void conflist(uint8_t *out)
+{
+  uint8_t i, c;
+
+  out = confline(out, SETGUARD, conf.guard);
+  out = confline(out, SETGUARDINT, conf.guardinterval);
+  out = confline(out, SETCOUNT, conf.multicount);
+  out = confline(out, SETMULTI, conf.multiinterval);
+  out = confline(out, SETHTTP, conf.httpinterval);
+  out = confline(out, SETIGNITION, conf.ignition);
+  out = confline(out, SETIGNOFF, conf.ignitionoff);
+  out = confline(out, SETAUTOGUARD, conf.autoguard);
+  *out++ = '\n';
+  strcpy_P(out, SETAPN);
+  out += strlen(out);
+  *out++ = ' ';
+  for (i = 0; i < sizeof(((struct confblock *)0)->apn); i++)
+     {
+      c = eeprom_read_byte((const uint8_t *)(EECONFADDR + offsetof(struct confblock, apn) + i));
+      if ( (c == 0x00) || (c == 0xFF) ) break;
+      *out++ = c;
+     };
+  *out++ = '\n';
+  strcpy_P(out, SETURL);
+  out += strlen(out);
+  *out++ = ' ';
+  for (i = 0; i < sizeof(((struct confblock *)0)->url); i++)
+     {
+      c = eeprom_read_byte((const uint8_t *)(EECONFADDR + offsetof(struct confblock, url) + i));
+      if ( (c == 0x00) || (c == 0xFF) ) break;
+      *out++ = c;
+     };
+  *out = 0x00;
+}
 
-};    // repeat until i not zero
 
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENERGY ACCOUNTING - totals in EEPROM at EEENERGYADDR sealed with CRC, listing
+//////////////////////////////////////////////////////////////////////////////////
+
+// write totals to EEPROM - only changed bytes are written
+void energysave(void)
+{
+  energyupdate();
+  eeprom_update_block((const void *)energytime, (void *)EEENERGYADDR, sizeof(energytime));
+  eeprom_update_word((uint16_t *)(EEENERGYADDR + sizeof(energytime)), eecrc(EEENERGYADDR, sizeof(energytime)));
+  energysaved = getuptime();
 }
 
-// 
-// delay multiplication of 50 microseconds
-//
+// read totals saved before reset, start from zero if they are not valid
+void energyload(void)
+{
+  eeprom_read_block((void *)energytime, (const void *)EEENERGYADDR, sizeof(energytime));
+  if (eeprom_read_word((const uint16_t *)(EEENERGYADDR + sizeof(energytime))) != eecrc(EEENERGYADDR, sizeof(energytime)))
+     memset(energytime, 0, sizeof(energytime));
+}
 
-void delay_50usec()
+// estimated charge of 'state' in 0.1mAh - seconds are divided first not to overflow
+uint32_t energycharge(uint8_t state)
 {
-// Generated by delay loop calculator
-// at http://www.bretmulvey.com/avrdelay.html
-// Delay 50 cycles
-// 50us at 1 MHz
+return((energytime[state] / 360UL) * conf.current[state] / 10UL);
+}
 
-asm volatile (
-    "    ldi  r18, 16"	"\n"
-    "1:  dec  r18"	"\n"
-    "    brne 1b"	"\n"
-    "    rjmp 1f"	"\n"
-    "1:"	"\n"
-);
+// append value in tenths as "v.t" to 'out' buffer, returns pointer to end of string
+uint8_t *energytenths(uint8_t *out, uint32_t value)
+{
+  ultoa(value / 10, out, 10);
+  out += strlen(out);
+  *out++ = '.';
+  *out++ = '0' + value % 10;
+  *out = 0x00;
+return(out);
+}
+
+// list minutes and charge of every state and total charge to 'out' buffer as part of SMS
+void energylist(uint8_t *out)
+{
+  uint8_t state;
+  uint32_t total;
+
+  energyupdate();
+  total = 0;
+  for (state = 0; state < ENERGYSTATES; state++)
+     {
+      *out++ = '\n';
+      strcpy_P(out, (const char *)pgm_read_word(&ENERGYNAMES[state]));
+      out += strlen(out);
+      *out++ = ' ';
+      ultoa(energytime[state] / 60, out, 10);
+      out += strlen(out);
+      *out++ = ' ';
+      out = energytenths(out, energycharge(state));
+      total += energycharge(state);
+     };
+  strcpy_P(out, ENERGYTOTAL);
+  energytenths(out + strlen(out), total);
+}
+
+// total estimated charge in mAh
+uint32_t energytotal(void)
+{
+  uint8_t state;
+  uint32_t total;
+
+  energyupdate();
+  total = 0;
+  for (state = 0; state < ENERGYSTATES; state++)  total += energycharge(state);
+return(total / 10);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// GNSS ACQUISITION - histogram in EEPROM at EEGNSSADDR sealed with CRC, listing
+//////////////////////////////////////////////////////////////////////////////////
 
+// write histogram to EEPROM - only changed bytes are written
+void gnsssave(void)
+{
+  eeprom_update_block((const void *)&gnsslog, (void *)EEGNSSADDR, sizeof(gnsslog));
+  eeprom_update_word((uint16_t *)(EEGNSSADDR + sizeof(gnsslog)), eecrc(EEGNSSADDR, sizeof(gnsslog)));
+}
+
+// read histogram saved before reset, start from zero if it is not valid
+void gnssload(void)
+{
+  eeprom_read_block((void *)&gnsslog, (const void *)EEGNSSADDR, sizeof(gnsslog));
+  if (eeprom_read_word((const uint16_t *)(EEGNSSADDR + sizeof(gnsslog))) != eecrc(EEGNSSADDR, sizeof(gnsslog)))
+     memset(&gnsslog, 0, sizeof(gnsslog));
+}
+
+// list non-empty buckets as "<16=n" ... "512+=n", timeouts and average satellites of every start mode
+// to 'out' buffer as part of SMS, listing is cut before it could overflow SMS text buffer
+void gnsslist(uint8_t *out)
+{
+  uint8_t mode, bucket;
+  uint16_t fixes;
+  uint8_t *end;
+
+  end = out + BUFFER_SIZE - 32;
+  for (mode = 0; mode < GNSSMODES; mode++)
+     {
+      if (out > end)  return;
+      strcpy_P(out, (const char *)pgm_read_word(&GNSSMODENAMES[mode]));
+      out += strlen(out);
+      fixes = 0;
+      for (bucket = 0; bucket < GNSSTIMEOUT; bucket++)
+         {
+          if (gnsslog.bucket[mode][bucket] == 0)  continue;
+          if (out > end)  return;
+          fixes += gnsslog.bucket[mode][bucket];
+          *out++ = ' ';
+          if (bucket < GNSSTIMEOUT - 1)  *out++ = '<';
+          utoa(16U << ((bucket < GNSSTIMEOUT - 1) ? bucket : bucket - 1), out, 10);
+          out += strlen(out);
+          if (bucket == GNSSTIMEOUT - 1)  *out++ = '+';
+          *out++ = '=';
+          utoa(gnsslog.bucket[mode][bucket], out, 10);
+          out += strlen(out);
+         };
+      if (out > end)  return;
+      if (gnsslog.bucket[mode][GNSSTIMEOUT] > 0)
+         {
+          strcpy_P(out, TTFFTIMEOUT);
+          utoa(gnsslog.bucket[mode][GNSSTIMEOUT], out + strlen(out), 10);
+          out += strlen(out);
+         };
+      if (fixes > 0)
+         {
+          strcpy_P(out, TTFFSAT);
+          utoa(gnsslog.sats[mode] / fixes, out + strlen(out), 10);
+          out += strlen(out);
+         };
+     };
+}
+
+
+#if ATTRACE
+//////////////////////////////////////////////////////////////////////////////////
+// AT TRACE - listing
+//////////////////////////////////////////////////////////////////////////////////
+
+// list entries newest first as "command class ms" to 'out' buffer as part of SMS, command is shown
+// without "AT+" up to its parameters, listing is cut before it could overflow SMS text buffer
+void tracelist(uint8_t *out)
+{
+  uint8_t entry, slot, i;
+  const char *p;
+  uint8_t *end;
+  char c;
+
+  end = out + BUFFER_SIZE - 24;
+  for (entry = 0; (entry < tracecount) && (out <= end); entry++)
+     {
+      slot = (tracehead + TRACESIZE - 1 - entry) % TRACESIZE;
+      p = trace[slot].cmd;
+      if (pgm_read_byte(p + 2) == '+')  p += 3;
+      *out++ = '\n';
+      for (i = 0; i < 10; i++)
+         {
+          c = pgm_read_byte(p++);
+          if ( (c == 0x00) || (c == '=') || (c == '?') || (c == '\r') || (c == '"') )  break;
+          *out++ = c;
+         };
+      *out++ = ' ';
+      *out++ = pgm_read_byte(&TRACECLASSES[trace[slot].result]);
+      *out++ = ' ';
+      utoa(trace[slot].ms, out, 10);
+      out += strlen(out);
+     };
+  *out = 0x00;
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// STATISTICS - counters since reset, items in order of STATSNAMES
+//////////////////////////////////////////////////////////////////////////////////
+
+// paint free SRAM below stack with STACKCANARY - interrupts are disabled not to paint over their frames
+void stackpaint(void)
+{
+  uint8_t *p;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+     {
+      for (p = (uint8_t *)&__heap_start; p < (uint8_t *)SP; p++)  *p = STACKCANARY;
+     };
+}
+
+// bytes of free SRAM which were never used by stack since last painting
+uint16_t stackfree(void)
+{
+  uint8_t *p;
+
+  p = (uint8_t *)&__heap_start;
+  while ( (p < (uint8_t *)SP) && (*p == STACKCANARY) )  p++;
+return(p - (uint8_t *)&__heap_start);
+}
+
+uint32_t statsvalue(uint8_t item)
+{
+  switch (item)
+     {
+      case 0:  return(getuptime());
+      case 1:  return(resetcause);
+      case 2:  return(gnssfixes);
+      case 3:  return(gnsssearches);
+      case 4:  return( (ttffcount > 0) ? (ttffsum / ttffcount) : 0 );
+      case 5:  return(ttfflast);
+      case 6:  return(smssent);
+      case 7:  return(smssent + smsfailed);
+      case 8:  return(smsretries);
+      case 9:  return(httpok);
+      case 10: return(httpposts);
+      case 11: return(bearerretries);
+      case 12: return(regtime);
+      case 13: return(regsearches);
+      case 14: return(uartoverruns);
+      case 15: return((uint8_t *)&__heap_start - (uint8_t *)RAMSTART);
+      case 16: return(stackfree());
+     };
+return(0);
+}
+
+// list statistics to 'out' buffer as part of SMS
+void statslist(uint8_t *out)
+{
+  uint8_t item;
+  uint8_t *end;
+
+  *out = 0x00;
+  end = out + BUFFER_SIZE - 24;
+  for (item = 0; (item < STATSITEMS) && (out <= end); item++)
+     {
+      strcpy_P(out, (const char *)pgm_read_word(&STATSNAMES[item]));
+      out += strlen(out);
+      ultoa(statsvalue(item), out, 10);
+      out += strlen(out);
+     };
+}
+
+// send statistics to SIM7000 as comma separated HTTP parameter value
+void statsputs(void)
+{
+  uint8_t item;
+
+  for (item = 0; item < STATSITEMS; item++)
+     {
+      if (item > 0)  send_uart(',');
+      uart_putu(statsvalue(item));
+     };
+}
+
+// start counting from zero, reset cause and uptime are kept
+void statsreset(void)
+{
+  gnsssearches = 0;
+  gnssfixes = 0;
+  ttffsum = 0;
+  ttffcount = 0;
+  ttfflast = 0;
+  smssent = 0;
+  smsfailed = 0;
+  smsretries = 0;
+  httpposts = 0;
+  httpok = 0;
+  bearerretries = 0;
+  regsearches = 0;
+  regtime = 0;
+  uartoverruns = 0;
+  stackpaint();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// SCHEDULED REPORTS - table of time-of-day / day-of-week entries in EEPROM
+// SIM7000 and GNSS are woken up SCHEDLEAD seconds before scheduled minute
+//////////////////////////////////////////////////////////////////////////////////
+
+// read schedule entry from EEPROM
+void schedread(uint8_t slot, struct schedentry *entry)
+{
+  eeprom_read_block((void *)entry, (const void *)(EESCHEDADDR + slot * sizeof(struct schedentry)), sizeof(struct schedentry));
+}
+
+// plan next periodic report deadline on the grid of 'interval' seconds counted from the first report
+// so time spent on GNSS fix and sending is not added to the interval, missed deadlines are skipped
+void plannext(uint16_t interval)
+{
+  uint32_t now;
+
+  // longer intervals in SAVER and CRITICAL power profile
+  interval <<= powerprofile;
+  now = getuptime();
+  nextreport += interval;
+  while (nextreport < now) nextreport += interval;
+}
 
+// find next scheduled report after current SOFT RTC time and put it to 'schedtime' and 'schedaction'
+// returns timebase second when SIM7000 and GNSS must be woken up, 0 if nothing scheduled
+uint32_t schednext(void)
+{
+  struct schedentry entry;
+  uint32_t now, local, midnight, candidate;
+  uint16_t today;
+  uint8_t slot, day, weekday;
+
+  schedtime = 0;
+  schedaction = 0;
+
+  // without time there is no schedule
+  now = rtcnow();
+  if (now == 0) return(0);
+
+  local = now + (int32_t)SCHEDZONE * 60L;
+  today = local / 86400UL;
+
+  for (slot = 0; slot < SCHEDSLOTS; slot++)
+     {
+      schedread(slot, &entry);
+      if ( (entry.minute >= 1440) || (entry.days == 0) || (entry.action == 0) || (entry.action > 2) ) continue;
+
+      // check today and next 7 days for first matching day of week
+      for (day = 0; day < 8; day++)
+         {
+          // 2000-01-01 was Saturday, bit 0 of days mask is Monday
+          weekday = (today + day + 5) % 7;
+          if ( (entry.days & (1 << weekday)) == 0 ) continue;
+
+          midnight = (uint32_t)(today + day) * 86400UL - (int32_t)SCHEDZONE * 60L;
+          candidate = midnight + (uint32_t)entry.minute * 60UL;
+          // skip reports already in the past or already triggered
+          if ( (candidate <= now) || (candidate <= schedlast) ) continue;
+
+          if ( (schedtime == 0) || (candidate < schedtime) )
+             {
+              schedtime = candidate;
+              schedaction = entry.action;
+             };
+          break;
+         };
+     };
+
+  if (schedtime == 0) return(0);
+
+  // wake up before scheduled minute to have GNSS fix ready on time
+  if ( (schedtime - now) <= SCHEDLEAD ) return(getuptime());
+  return getuptime() + (schedtime - now) - SCHEDLEAD;
+}
+
+// list all schedule entries to 'out' buffer as part of SMS - "n hhmm days action"
+void schedlist(uint8_t *out)
+{
+  struct schedentry entry;
+  uint8_t slot, day;
+
+  for (slot = 0; slot < SCHEDSLOTS; slot++)
+     {
+      schedread(slot, &entry);
+      if (entry.minute >= 1440) continue;
+      *out++ = '\n';
+      *out++ = '1' + slot;
+      *out++ = ' ';
+      *out++ = '0' + entry.minute / 600;
+      *out++ = '0' + (entry.minute / 60) % 10;
+      *out++ = '0' + (entry.minute % 60) / 10;
+      *out++ = '0' + entry.minute % 10;
+      *out++ = ' ';
+      for (day = 0; day < 7; day++)   if (entry.days & (1 << day)) *out++ = '1' + day;
+      *out++ = ' ';
+      *out++ = '0' + entry.action;
+     };
+  *out = 0x00;
 }
 
+// update schedule entry from SMS "SCHED n hhmm days action" or "SCHED n OFF"
+// days are digits 1 = Monday ... 7 = Sunday or 0 for every day, action 1 = SINGLE, 2 = MULTI
+// returns 1 if entry was changed
+uint8_t schedupdate(void)
+{
+  struct schedentry entry;
+  uint8_t *p;
+  uint8_t slot;
+  uint16_t hhmm;
+
+  p = smsparam(ISSCHED, 1);
+  if (p == NULL) return(0);
+  slot = atoi(p);
+  if ( (slot < 1) || (slot > SCHEDSLOTS) ) return(0);
+  slot--;
 
+  p = smsparam(ISSCHED, 2);
+  if (p == NULL) return(0);
+
+  entry.minute = 0xFFFF;         // empty entry
+  entry.days = 0;
+  entry.action = 0;
+
+  if (strncmp_P(p, SCHEDOFF, sizeof(SCHEDOFF) - 1) != 0)
+     {
+      hhmm = atoi(p);
+      if ( (hhmm / 100 > 23) || (hhmm % 100 > 59) ) return(0);
+      entry.minute = (hhmm / 100) * 60 + (hhmm % 100);
+
+      // days of week as digits
+      p = smsparam(ISSCHED, 3);
+      if (p == NULL) return(0);
+      while ( (*p >= '0') && (*p <= '7') )
+         {
+          if (*p == '0')  entry.days = 0x7F;
+          else            entry.days |= 1 << (*p - '1');
+          p++;
+         };
+
+      // action, SINGLE by default
+      entry.action = 1;
+      p = smsparam(ISSCHED, 4);
+      if (p != NULL) entry.action = atoi(p);
+      if ( (entry.days == 0) || (entry.action < 1) || (entry.action > 2) ) return(0);
+     };
+
+  eeprom_update_block((const void *)&entry, (void *)(EESCHEDADDR + slot * sizeof(struct schedentry)), sizeof(struct schedentry));
+
+return(1);
+}
 
 
 
@@ -697,6 +3868,20 @@ asm volatile (
 // -------------------------------------------------------------------------------
 // wait for first AT in case SIM7000 is starting up
 // -------------------------------------------------------------------------------
+// wake up SIM7000 from SLEEPMODE - DTR is pulled LOW while dummy AT and SLEEPMODE = 0 are sent,
+// then it goes HIGH again so SLEEPON later lets SIM7000 sleep
+void modemwake(void)
+{
+  PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
+  // send first dummy AT command
+  uart_puts_P(AT);
+  delay_sec(1);
+  uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
+  delay_sec(1);
+  PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
+  delay_sec(1);
+}
+
 uint8_t checkat()
 {
   uint8_t initialized2;
@@ -710,13 +3895,11 @@ uint8_t checkat()
                uart_puts_P(AT);
                 if (readline()>0)
                    {  // check if OK was received
-                    memcpy_P(buf, ISOK, sizeof(ISOK));                     
-                   if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  initialized2 = 1;                  
+                   if (is_in_rx_buffer_P(response, ISOK, BUFFER_SIZE) == 1)  initialized2 = 1;                  
                    }
                 else
                    { // maybe ECHO is ON and first line was AT
-                    memcpy_P(buf, ISATECHO, sizeof(ISATECHO));                     
-                   if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  initialized2 = 1;                  
+                   if (is_in_rx_buffer_P(response, ISATECHO, BUFFER_SIZE) == 1)  initialized2 = 1;                  
                    };
 
                delay_sec(1);
@@ -731,7 +3914,8 @@ uint8_t checkat()
 }
 
 // -------------------------------------------------------------------------------
-// check if PIN is needed and enter PIN 1111 
+// check if PIN is needed and enter PIN from configuration - only once until SIM reports READY,
+// repeating wrong PIN would block SIM by PUK, returns 0 if PIN was rejected
 // -------------------------------------------------------------------------------
 uint8_t checkpin()
 {
@@ -744,13 +3928,19 @@ uint8_t checkpin()
                 uart_puts_P(SHOW_PIN);
                 if (readline()>0)
                    {
-                    memcpy_P(buf, PIN_IS_READY, sizeof(PIN_IS_READY));
-                  if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)       initialized2 = 1;                                         
-                    memcpy_P(buf, PIN_MUST_BE_ENTERED, sizeof(PIN_MUST_BE_ENTERED));
-                  if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)     
+                  if (is_in_rx_buffer_P(response, PIN_IS_READY, BUFFER_SIZE) == 1)
+                        {
+                           initialized2 = 1;
+                           pinsent = 0;
+                        };
+                  if (is_in_rx_buffer_P(response, PIN_MUST_BE_ENTERED, BUFFER_SIZE) == 1)     
                         {  
+                           if (pinsent == 1)  return (0);
+                           pinsent = 1;
                            delay_sec(1);
-                           uart_puts_P(ENTER_PIN);   // ENTER PIN 1111
+                           uart_puts_P(ENTER_PIN);   // ENTER PIN from configuration
+                           confputs(offsetof(struct confblock, pin));
+                           uart_puts_P(QUOTECR);
                            delay_sec(1);
                         };                  
                     };
@@ -767,6 +3957,7 @@ uint8_t checkpin()
 uint8_t checkregistration()
 {
   uint8_t initialized2, attempt2, nbrminutes;
+  uint32_t searchstart;
      // readline and wait for STATUS NETWORK REGISTRATION from SIM7000
      // first 2 networks preferred from SIM list are OK
      initialized2 = 0;
@@ -778,12 +3969,14 @@ uint8_t checkregistration()
      uart_puts_P(SHOW_REGISTRATION);
      if (readline()>0)
         {                                    
-         memcpy_P(buf, ISREG1, sizeof(ISREG1));
-         if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  return(1); 
-         memcpy_P(buf, ISREG2, sizeof(ISREG2));
-         if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  return(1); 
+         if (is_in_rx_buffer_P(response, ISREG1, BUFFER_SIZE) == 1)  return(1); 
+         if (is_in_rx_buffer_P(response, ISREG2, BUFFER_SIZE) == 1)  return(1); 
         } 
 
+     // network search is counted in statistics
+     regsearches++;
+     searchstart = getuptime();
+
      // if not registered enable radio.. just in case
                  // TURN ON RADIO IF WAS NOT BEFORE
                  delay_sec(1);
@@ -796,10 +3989,8 @@ uint8_t checkregistration()
 
                  if (readline()>0)
                    {                                    
-                    memcpy_P(buf, ISREG1, sizeof(ISREG1));
-                   if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  initialized2 = 1; 
-                    memcpy_P(buf, ISREG2, sizeof(ISREG2));
-                   if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  initialized2 = 1; 
+                   if (is_in_rx_buffer_P(response, ISREG1, BUFFER_SIZE) == 1)  initialized2 = 1; 
+                   if (is_in_rx_buffer_P(response, ISREG2, BUFFER_SIZE) == 1)  initialized2 = 1; 
 
                   
                   // if not registered do a backoff for 1 hour, maybe in underground garage or something
@@ -823,29 +4014,185 @@ uint8_t checkregistration()
    
                       // Wake up SIM800L and search for network again                  
 
-                        // disable SLEEPMODE 
-                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                        // send first dummy AT command
-                        uart_puts_P(AT);
-                        delay_sec(1); 
-                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                        delay_sec(1); 
-                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                        delay_sec(1); 
-                        uart_puts_P(FLIGHTOFF);  // disable airplane mode - turn on radio and start to search for networks
-                      }; // end of no-coverage IF
+                        modemwake();            // disable SLEEPMODE of SIM7000
+                        uart_puts_P(FLIGHTOFF);  // disable airplane mode - turn on radio and start to search for networks
+                      }; // end of no-coverage IF
+
+                     
+                   }
+
+                attempt2++; // increase number of attempts - max 24 attempts = 12 hours of no signal 2G network
+
+                // end of DO loop
+                } while ( (initialized2 == 0) && (attempt2 < 24) );
+
+      if (initialized2 == 1)  regtime = getuptime() - searchstart;
+      return initialized2;
+}
+
+
+// -------------------------------------------------------------------------------
+// open IP bearer for Internet connectivity, returns 1 if attached
+// -------------------------------------------------------------------------------
+uint8_t openbearer()
+{
+  uint8_t attempt, attached;
+
+  // Internet connectivity initialization procedure
+  attempt = 0;
+  attached = 0;
+  do { 										
+      // close the bearer first just in case... maybe there was an error or something
+      uart_puts_P(SAPBRCLOSE);
+      // provision APN and username for Internet connectivity 
+      delay_sec(5);
+      uart_puts_P(SAPBR2);
+      confputs(offsetof(struct confblock, apn));
+      uart_puts_P(QUOTECR);
+      // only if username password in APN is needed
+      delay_sec(1);
+      uart_puts_P(SAPBR3);
+      confputs(offsetof(struct confblock, user));
+      uart_puts_P(QUOTECR);
+      delay_sec(1);
+      uart_puts_P(SAPBR4);
+      confputs(offsetof(struct confblock, pwd));
+      uart_puts_P(QUOTECR);
+      //  open IP bearer for communication
+      delay_sec(3);
+      uart_puts_P(SAPBROPEN);
+      // query PDP-bearer context for IP address after several seconds
+      // check if bearer was succesfull, do it max 3 times if needed
+      delay_sec(5);
+      uart_puts_P(SAPBRQUERY);
+      if (readline()>0)
+          {
+           // checking for properly attached
+           if (is_in_rx_buffer_P(response, SAPBRSUCC, BUFFER_SIZE) == 1)  attached = 1;
+            // other responses simply ignored as there was no attach
+          };
+      // increase attempt counter and repeat until not attached
+      attempt++;
+  } while ( (attempt < 3) && (attached == 0) );
+  bearerretries += attempt - 1;
+
+return(attached);
+}
+
+
+// -------------------------------------------------------------------------------
+// wait up to 'seconds' for result of HTTP request +HTTPACTION: method,status,length
+// returns HTTP status, 0 if there was no result
+// -------------------------------------------------------------------------------
+uint16_t httpresult(uint8_t seconds)
+{
+  uint32_t deadline;
+  uint16_t status;
+  char *p;
+
+  httpposts++;
+  deadline = getuptime() + seconds;
+  while (1)
+     {
+      while ( !(UCSR0A & (1<<RXC0)) )
+         {
+          if (getuptime() >= deadline) return(0);
+         };
+      readline();
+      if (strstr_P(response, ISHTTPACTION) != NULL)
+         {
+          p = strchr(response, ',');
+          status = (p != NULL) ? atoi(p + 1) : 0;
+          if ( (status >= 200) && (status < 300) )  httpok++;
+          return(status);
+         };
+     };
+}
+ 
+
 
-                     
-                   }
+//////////////////////////////////////////////////////////////////////////////////
+// POWER PROFILES - selected from supply voltage reported by AT+CBC and car battery state
+//////////////////////////////////////////////////////////////////////////////////
 
-                attempt2++; // increase number of attempts - max 24 attempts = 12 hours of no signal 2G network
+// send last known position to number stored by ACTIVATE before supply dies
+void lastgasp(void)
+{
+  uint8_t number[20], lat[11], lon[12];
+  int32_t latitude, longtitude;
+  uint8_t projected;
 
-                // end of DO loop
-                } while ( (initialized2 == 0) && (attempt2 < 24) );
+  if (ownernumber(number) == 0)  return;
 
-      return initialized2;
+  smsbegin();
+  smsadd_P(LASTGASP);
+  // last good fix - fix of current cycle may be empty or already replaced by an estimate
+  if (lastfixtime == 0)
+     {
+      smsadd_P(NOFIX);
+     }
+  else
+     {
+      latitude = lastfixlat;
+      longtitude = lastfixlong;
+      projected = drproject(&latitude, &longtitude);
+      // put short location link or link to GOOGLE MAPS
+      if (shortloc == 1)
+         {
+          geohashfrom(latitude, longtitude, (projected == 1) ? 7 : 8);
+          smsadd_P(SHORTLOC1);                // send short base URL
+          smsadd(geohash);                    // send geohash of the position
+         }
+      else
+         {
+          degreestring(lat, latitude);
+          degreestring(lon, longtitude);
+          smsadd_P(GOOGLELOC1);               // send http ****
+          smsadd(lat);                        // send LATTITUDE
+          smsadd_P(GOOGLELOC2);               // send comma
+          smsadd(lon);                        // send LONGTITUDE
+         };
+      smsadd_P(GOOGLELOC3);               // send CRLF
+      if (projected == 1) smsadd_P(ESTIMATED);
+     };
+  smsadd_P(BATT);                         // send BATTERY VOLTAGE in milivolts
+  smsadd(battery);                        // from buffer
+  smssend(number);
 }
- 
+
+// read supply voltage to 'battery' buffer and select power profile, thresholds of current profile are moved by hysteresis
+void powercheck(void)
+{
+  uint16_t supply, saver, critical;
+  uint8_t profile;
+
+  delay_sec(1);
+  uart_puts_P(CHECKBATT);
+  if (readbattery() == 0) return;
+  supply = atoi(battery);
+  if (supply == 0) return;
+
+  saver = POWERSAVER_LVL;
+  critical = POWERCRITICAL_LVL;
+  if (powerprofile != POWERNORMAL)    saver += POWERHYST;
+  if (powerprofile == POWERCRITICAL)  critical += POWERHYST;
+
+  profile = POWERNORMAL;
+  if (supply < saver)     profile = POWERSAVER;
+  if (supply < critical)  profile = POWERCRITICAL;
+  // weak car battery - do not drain it
+  if ( (carbattstate == CARBATTWEAK) && (profile == POWERNORMAL) )  profile = POWERSAVER;
+  powerprofile = profile;
+
+  // last gasp is sent once, again only after supply recovered
+  if (supply > critical)  lastgaspsent = 0;
+  if ( (supply < POWERLASTGASP) && (lastgaspsent == 0) )
+     {
+      lastgaspsent = 1;
+      lastgasp();
+     };
+}
+
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -857,7 +4204,9 @@ uint8_t checkregistration()
 void sleepnow(void)
 {
 
-    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    // TIMER0 debouncing alarm input and ADC sample stop in power down - use IDLE sleep until they finish
+    if ( (TCCR0B != 0) || (adcmode != 0) )  set_sleep_mode(SLEEP_MODE_IDLE);
+    else              set_sleep_mode(SLEEP_MODE_PWR_DOWN);
 
     sleep_enable();
 
@@ -879,7 +4228,7 @@ void sleepnow(void)
 
     sleep_cpu();                   //go to sleep
 
-    // MCU ATTMEGA328P sleeps here until INT0 interrupt
+    // MCU ATTMEGA328P sleeps here until INT0 interrupt ( or INT1 alarm input )
 
     sleep_disable();               //wake up here
 
@@ -903,19 +4252,27 @@ ISR(INT0_vect)
 
 int main(void) {
 
-  uint8_t initialized, ringrcvd,  attempt, gpsdataavailable,  char1;
-  double   latdiff, longdiff;
-  uint32_t nbr50useconds;
+  uint8_t initialized, ringrcvd, gpsdataavailable,  char1, scheduled, gpsresult, inboxcheck, clearafter;
+  int32_t  latdiff, longdiff, guardlat, guardlong;      // microdegrees
+  uint32_t netcheck;
   uint32_t nbrseconds;
+  uint32_t schedwake;
+
+  // reset cause is kept for statistics and cleared for next reset
+  resetcause = MCUSR;
+  MCUSR = 0;
+  // free SRAM is painted to measure worst case stack depth
+  stackpaint();
 
-  attempt = 0;           // number of attempts for GPRS connections
   initialized = 0;       // flag for getting in-out of loops
   ringrcvd = 0;          // flag if there was anything valuable received
  
   latdiff = 0;           // calculation of position change for GUARD MODE
   longdiff = 0;          // calculation of position change for GUARD MODE  
+  guardlat = 0;          // position of previous GUARD MODE check, 0 = none yet
+  guardlong = 0;
  
-  nbr50useconds = 0;     // timer for checking serial port activities or SIM7000 chip sanity
+  netcheck = 0;          // uptime of next check of SIM7000 chip sanity while waiting for serial port activities
   nbrseconds = 0;        // used for delay function 
 
   continousgps = 0;      // distinguish between modes : 1 = single, 5 = multi, 255 = guard
@@ -938,16 +4295,22 @@ int main(void) {
   //PORTD |= (1 << PORTD0);    // turn On the Pull-up
   // PD2 is now an input with pull-up enabled
 
-  // initialize variables
-  memcpy_P(latitudegpsold, INITLOC, sizeof(INITLOC));
-  memcpy_P(latitudegps, INITLOC, sizeof(INITLOC));
-  memcpy_P(longtitudegpsold, INITLOC, sizeof(INITLOC));
-  memcpy_P(longtitudegps, INITLOC, sizeof(INITLOC));
-  memcpy_P(utctimegps, INITLOC, sizeof(INITLOC)); 
-
   // initialize 9600 baud 8N1 RS232
   init_uart();
 
+  // start 1 second timebase and enable interrupts for it
+  init_timebase();
+  // enable INPUT on INT1 / PD3 ( ATMEGA PIN #5 ) to connect alarm output of the car alarm system
+  if (alarminput == 1)  init_alarm();
+  // CAR BATTERY voltage is sampled in background from now on
+  init_adc();
+  sei();
+
+  // energy accounting and GNSS histogram continue totals saved before reset, SIM7000 is awake after power on
+  energyload();
+  gnssload();
+  energymodem(E_AWAKE);
+
   // delay 10 seconds for safe SIM7000 startup and network registration
   delay_sec(10);
 
@@ -976,25 +4339,48 @@ int main(void) {
   uart_puts_P(DISREGREPORT);
   delay_sec(1);
 
+  // enable network time update of SIM7000 clock to seed SOFT RTC before first GNSS fix
+  uart_puts_P(ENABLENITZ);
+  delay_sec(1);
+
+  // show number of voice caller after RING
+  uart_puts_P(ENABLECLIP);
+  delay_sec(1);
+
 
   // Save settings to SIM7000
   uart_puts_P(SAVECNF);
   delay_sec(3);
 
+  // read configuration from EEPROM - PIN is needed now
+  confload();
+
   // check PIN status 
   checkpin();
   delay_sec(1); 
 
+  // cache hashes of whitelisted numbers
+  whiteload();
+
   // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+  // in inbox mode unread SMS are kept - commands sent while tracker was off will be processed
+  if (smsinbox == 1) delsms = DELSMSREAD;
   uart_puts_P(SMS1);
   delay_sec(1); 
-  uart_puts_P(DELSMS);
+  // request delivery reports also for SMS sent in text mode
+  uart_puts_P(SMSPARAM);
+  delay_sec(1); 
+  uart_puts_P(delsms);
 
   // delay another 90 sec to search for GSM network
   delay_sec(90);
 
   // check registration status 
   checkregistration();
+
+  // seed SOFT RTC from network time if available
+  delay_sec(1);
+  readclock();
  
   // neverending LOOP
 
@@ -1005,7 +4391,8 @@ int main(void) {
                    initialized = 0;
                    ringrcvd = 0;
                    continousgps = 0;
-                   nbr50useconds = 0UL;
+                   ackpending = 0;
+                   ignitionsession = 0;
                    nbrseconds = 0;
                 
                 // marker for SIM7000 GPS data availability  
@@ -1015,9 +4402,17 @@ int main(void) {
                 // set mode to display incoming SMS, will be needed for retrieval of originating MSISDN 
                    uart_puts_P(SMS1);
                    delay_sec(1); 
-                   uart_puts_P(SHOWSMS); 
+                   if (smsinbox == 1)  uart_puts_P(SHOWSMSINBOX); 
+                   else                uart_puts_P(SHOWSMS); 
                    delay_sec(1);
 
+                // SMS stored while GNSS fix or sending was in progress are processed before sleeping
+                // ( in direct mode SMS are stored only during MULTI, GUARD or HTTP session )
+                   inboxcheck = readinbox(NULL);
+
+                // SMS which were not accepted by network are sent again while SIM7000 is awake
+                   if (smsqueue_len > 0)  smsflush();
+
                 // OPTIONAL
                 // Disable LED blinking on  SIM7000
                 //   uart_puts_P(DISABLELED);
@@ -1027,8 +4422,11 @@ int main(void) {
                // ( will be interrupted by incoming voice call or SMS ) and RING URC
                     uart_puts_P(GPSPWROFF); 
                     delay_sec(1);
-                    uart_puts_P(SLEEPON); 
-                    delay_sec(2);
+                    if (inboxcheck == 0)
+                       {
+                        uart_puts_P(SLEEPON); 
+                        delay_sec(2);
+                       };
      
                // ONLY if you have connected SIM7000 RI/RING pin to ATMEGA328P INT0 pin
                // otherwise program will HANG here
@@ -1061,15 +4459,7 @@ int main(void) {
                                      if (nbrseconds == 3600)
                                           { // if 3600sec passed, we need to check 2G network coverage
                                             nbrseconds = 0;
-                                            // disable SLEEPMODE 
-                                            PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                            // send first dummy AT command
-                                            uart_puts_P(AT);
-                                            delay_sec(1); 
-                                            uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                            delay_sec(1); 
-                                            PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                            delay_sec(1);
+                                            modemwake();            // disable SLEEPMODE of SIM7000
                                             //  check 2G coverage
                                             checkregistration();
                                             // enter SLEEP MODE of SIM7000 again 
@@ -1090,10 +4480,17 @@ int main(void) {
 
 
              // If RI/RING is unavailable then we are waiting for something from uart
-                nbr50useconds = 0UL;
+                netcheck = getuptime() + NETCHECK;
              // first empty RX buffer just in case
                 while (UCSR0A & (1<<RXC0)) char1 = UDR0; 
 
+             // find next scheduled report - when to wake up SIM7000 and GNSS for it
+                scheduled = 0;
+                schedwake = schednext();
+
+             // stored SMS is waiting - do not wait for anything
+                if (inboxcheck == 1)  initialized = 1;
+
              // then wait for something valuable and increase timer  
                 while(initialized == 0)
                             {
@@ -1106,24 +4503,24 @@ int main(void) {
                               else
                                  {    // there was NOTHING received over serial port so we are still waiting...
                                       //
-                                     nbr50useconds++;           // increase number of 50useconds waited
                                      delay_50usec();            // wait another 50usec
-                                     // if something like 15min ~ 30min passed 
+                                     // if NETCHECK seconds passed by TIMER1 timebase
                                      // we need to check if there is need to turn off 2G for longer time
-                                     if (nbr50useconds == 18000000UL)
+                                     if (getuptime() >= netcheck)
                                           { // if specified amount of second passed, we need to check 2G network coverage
-                                            nbr50useconds = 0UL;
-                                            // disable SLEEPMODE 
-                                            PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                            // send first dummy AT command
-                                            uart_puts_P(AT);
-                                            delay_sec(1); 
-                                            uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                            delay_sec(1); 
-                                            PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                            delay_sec(1);
+                                            modemwake();            // disable SLEEPMODE of SIM7000
                                             //  check 2G coverage
                                             checkregistration();
+                                            // seed SOFT RTC from network time if there was no GNSS fix yet
+                                            readclock();
+                                            // check supply voltage - power profile and last gasp report
+                                            powercheck();
+                                            // keep energy accounting totals across resets
+                                            if ( (getuptime() - energysaved) >= ENERGYSAVE )
+                                               {
+                                                energysave();
+                                                gnsssave();
+                                               };
                                             // enter SLEEP MODE of SIM7000 again
                                             delay_sec(1);
                                             uart_puts_P(SLEEPON); 
@@ -1134,102 +4531,328 @@ int main(void) {
                                             continousgps = 0;
                                             // empty RX buffer just in case
                                             while (UCSR0A & (1<<RXC0)) char1 = UDR0; 
+                                            // SOFT RTC may be set now - find next scheduled report again
+                                            schedwake = schednext();
+                                            netcheck = getuptime() + NETCHECK;
+                                          };
+
+                                     // time to wake up for scheduled report ?
+                                     if ( (schedwake != 0) && (getuptime() >= schedwake) )
+                                          {
+                                            schedwake = 0;
+                                            schedlast = schedtime;
+                                            // scheduled reports are sent to number stored by ACTIVATE command
+                                            if (ownernumber(phonenumber) == 1)
+                                               {
+                                                modemwake();            // disable SLEEPMODE of SIM7000
+
+                                                // mark 'initialized' flag to further proceed outside do-while loop
+                                                // GNSS is powered on by first cycle of SINGLE or MULTI
+                                                initialized = 1;
+                                                ringrcvd = 1;
+                                                scheduled = 1;
+                                                scheddue = schedtime;
+                                                multicount = conf.multicount;
+                                                multiinterval = conf.multiinterval;
+                                                if (schedaction == 2)  continousgps = multicount;
+                                                else                   continousgps = 1;
+                                               }
+                                            else  schedwake = schednext();     // no number activated - skip this entry
+                                          };
+
+                                     // alarm input triggered ?
+                                     if (alarmflag == 1)
+                                          {
+                                            // alarm SMS and MULTI positions are sent to number stored by ACTIVATE command
+                                            if (ownernumber(phonenumber) == 1)
+                                               {
+                                                modemwake();            // disable SLEEPMODE of SIM7000
+
+                                                // start GNSS first - it searches for fix while alarm SMS is being sent
+                                                uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
+                                                delay_sec(2);  
+                                                gnssrestart();              // cold or warm start of SIM7000 GPS
+                                                delay_sec(1);  
+                                                gnssstarted = 1;
+                                                alarmnotify(COMMANDMULTIACK);
+
+                                                // mark 'initialized' flag to further proceed outside do-while loop
+                                                // there is no command to read like for scheduled report
+                                                initialized = 1;
+                                                ringrcvd = 1;
+                                                scheduled = 1;
+                                                multicount = conf.multicount;
+                                                multiinterval = conf.multiinterval;
+                                                continousgps = multicount;
+                                               }
+                                            else  alarmflag = 0;     // no number activated - nobody to notify
+                                          };
+
+                                     // car battery crossed threshold ?
+                                     if ( (carbattalerts == 1) && (carbattmonitor() == 1) )
+                                          {
+                                            modemwake();            // disable SLEEPMODE of SIM7000
+
+                                            // disconnected battery may be theft - GNSS searches for fix while alert SMS is sent
+                                            if (carbattstate == CARBATTDISCONNECTED)
+                                               {
+                                                uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
+                                                delay_sec(2);  
+                                                gnssrestart();              // cold or warm start of SIM7000 GPS
+                                                delay_sec(1);  
+                                                gnssstarted = 1;
+                                               };
+
+                                            if ( (carbattnotify() == 1) && (carbattstate == CARBATTDISCONNECTED) )
+                                               {
+                                                // SINGLE position is sent to number stored by ACTIVATE command
+                                                ownernumber(phonenumber);
+                                                initialized = 1;
+                                                ringrcvd = 1;
+                                                scheduled = 1;
+                                                continousgps = 1;
+                                               }
+                                            else
+                                               {
+                                                // enter SLEEP MODE of SIM7000 again
+                                                if (gnssstarted == 1)  uart_puts_P(GPSPWROFF);
+                                                gnssstarted = 0;
+                                                delay_sec(1);
+                                                uart_puts_P(SLEEPON); 
+                                                delay_sec(1);
+                                                // empty RX buffer just in case
+                                                while (UCSR0A & (1<<RXC0)) char1 = UDR0; 
+                                               };
+                                          };
+
+                                     // engine started or stopped ?
+                                     if (conf.ignition != 0)  ignitionmonitor();
+
+                                     // engine is running - track the vehicle while it is in use
+                                     // or GUARD MODE is armed after engine stopped
+                                     if ( (initialized == 0) && (conf.ignition != 0) &&
+                                          ( ( (engine == 1) && (ignitiontracked == 0) ) || (autoguardpending == 1) ) )
+                                          {
+                                            ignitiontracked = engine;
+                                            // positions and acknowledge are sent to number stored by ACTIVATE command
+                                            if (ownernumber(phonenumber) == 1)
+                                               {
+                                                modemwake();            // disable SLEEPMODE of SIM7000
+
+                                                // enable GPS for tracking or GUARD MODE
+                                                uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
+                                                delay_sec(2);  
+                                                gnssrestart();              // cold or warm start of SIM7000 GPS
+                                                delay_sec(1);
+                                                gnssstarted = 1;
+
+                                                if (engine == 0)
+                                                   {   // send number of GPS polling to 255 which means this is GUARD MODE
+                                                    autoguardpending = 0;
+                                                    smsbegin();
+                                                    smsadd_P(GUARD);
+                                                    smssend(phonenumber);
+                                                    ignitionsession = 2;
+                                                    continousgps = 255;
+                                                   }
+                                                else if ( (conf.ignition == 2) && (powerprofile != POWERCRITICAL) )
+                                                   {   // send number of GPS polling to 254 which means this is HTTP MODE
+                                                    httpinterval = conf.httpinterval;
+                                                    if (openbearer() == 1)  continousgps = 254;
+                                                   }
+                                                else
+                                                   {   // MULTI positions until engine is off
+                                                    multicount = MULTIMAX;
+                                                    multiinterval = conf.multiinterval;
+                                                    continousgps = multicount;
+                                                   };
+                                                if (ignitionsession == 0)
+                                                   {
+                                                    ignitionsession = 1;
+                                                    sendack(IGNITIONACK);
+                                                   };
+
+                                                // mark 'initialized' flag to further proceed outside do-while loop
+                                                // there is no command to read like for scheduled report
+                                                ringrcvd = 1;
+                                                scheduled = 1;
+                                                if (continousgps != 0)  initialized = 1;
+                                                else
+                                                   {   // no Internet connectivity - go back to sleep
+                                                    uart_puts_P(GPSPWROFF);
+                                                    gnssstarted = 0;
+                                                    ringrcvd = 0;
+                                                    scheduled = 0;
+                                                    delay_sec(1);
+                                                    uart_puts_P(SLEEPON); 
+                                                    delay_sec(1);
+                                                    // empty RX buffer just in case
+                                                    while (UCSR0A & (1<<RXC0)) char1 = UDR0; 
+                                                   };
+                                               }
+                                            else  autoguardpending = 0;     // no number activated - nobody to report to
                                           };
                                   };  // end of checking USART status
                              };  // end of WHILE for checking 2G coverage
 
 
 
-                if (readline()>0)
+                if ( (scheduled == 0) && ( (inboxcheck == 1) || (readline()>0) ) )
                     {
+                    // in inbox mode +CMTI notifies new stored SMS - wake up SIM7000 and read it from inbox
+                    if  ( (smsinbox == 1) && (inboxcheck == 0) && (is_in_rx_buffer_P(response, ISINBOX, BUFFER_SIZE) == 1) )  
+                            { 
+                                 modemwake();            // disable SLEEPMODE of SIM7000
+
+                                 inboxcheck = readinbox(NULL);
+                                 // nothing unread - go back to sleep
+                                 if (inboxcheck == 0)  ringrcvd = 1;
+                            };
+
+                    // incoming voice call - +CLIP with caller number follows RING
+                    if  ( (inboxcheck == 0) && (strcmp_P(response, ISRING) == 0) && (ringrcvd == 0) )  
+                            { 
+                                 readline();
+                                 phonenumber[0] = 0x00;
+                                 if (strstr_P(response, ISCLIP) != NULL)  readsmsphonenumber(0);
+
+                                 modemwake();            // disable SLEEPMODE of SIM7000
+
+                                 // reject the call - it is free for the caller
+                                 uart_puts_P(HANGUP);
+                                 delay_sec(1);
+
+                                 // whitelisted caller gets SINGLE position, other calls are only rejected
+                                 initialized = 0;
+                                 ringrcvd = 1;
+                                 continousgps = 0;
+                                 if ( (phonenumber[0] != 0x00) && (whitelisted(phonenumber) == 1) )
+                                    {
+                                     // send a SMS confirmation of the command now
+                                     // or only if there is no fix in a while when acknowledge is combined with position
+                                     ackmsg = COMMANDSINGLEACK;
+                                     if (combinedack == 1)  ackpending = 1;
+                                     else                   sendack(ackmsg);
+
+                                     // mark 'initialized' flag to further proceed outside do-while loop
+                                     initialized = 1; 
+                                     continousgps = 1; 
+                                    };
+                            };
+
                     // check if this is an SMS message first
 
-                    memcpy_P(buf, ISSMS, sizeof(ISSMS));  
-                    if  ( (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1) && (ringrcvd == 0) )  
+                    if  ( ( (inboxcheck == 1) || (is_in_rx_buffer_P(response, ISSMS, BUFFER_SIZE) == 1) ) && (ringrcvd == 0) )  
                             { 
-                                 // extract TXT SMS content first not to lose incoming serial port characters... timing issue...
-                                 readsmstxt();
-                                 // then we need to extract phone number from SMS message RESPONSE buffer
-                                 readsmsphonenumber(); 
+                                 // SMS from inbox is already read to buffers
+                                 if (inboxcheck == 0)
+                                    {
+                                     // extract TXT SMS content first not to lose incoming serial port characters... timing issue...
+                                     readsmstxt();
+                                     // then we need to extract phone number from SMS message RESPONSE buffer
+                                     readsmsphonenumber(0); 
+                                    };
 
                                  // clear the flags first
                                  initialized = 0;
                                  ringrcvd = 0; 
                                  continousgps = 0; 
 
+                                 // only numbers from whitelist may control the tracker - SMS from others is ignored
+                                 // before GNSS or radio is woken up and tracker goes back to sleep
+                                 if (whitelisted(phonenumber) == 0)
+                                    {
+                                     memset(smstext, 0x00, BUFFER_SIZE);     // no command will match
+                                     ringrcvd = 1;
+                                    };
+
+                                 // ACTIVATE, ALLOW, DENY and SET decide who controls the tracker - they are accepted
+                                 // only from number stored by ACTIVATE, other whitelisted numbers are ignored too
+                                 if ( (whiteowner(phonenumber) == 0) &&
+                                      ( (strncasecmp_P(smstext, ISSET, sizeof(ISSET) - 1) == 0) ||
+                                        (strcasestr_P(smstext, ISACTIVATE) != NULL) ||
+                                        (strcasestr_P(smstext, ISALLOW) != NULL) ||
+                                        (strcasestr_P(smstext, ISDENY) != NULL) ) )
+                                    {
+                                     memset(smstext, 0x00, BUFFER_SIZE);     // no command will match
+                                     ringrcvd = 1;
+                                    };
+
+                                 // checking if SMS begins with "SET" word - before conversion to upper case
+                                 if   (strncasecmp_P(smstext, ISSET, sizeof(ISSET) - 1) == 0)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // store new value in EEPROM if there are parameters, otherwise only list configuration
+                                        confupdate();
+
+                                       // send a SMS confirmation with whole configuration
+                                        smsbegin();
+                                        smsadd_P(CONFIG);
+                                        conflist(smstext);              // configuration is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+                                        // parameter names must not trigger other commands
+                                        memset(smstext, 0x00, BUFFER_SIZE);
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of SET IF
+
+
                                  // checking if there is "MULTI" word in SMS content buffer
-                                 memcpy_P(buf, ISMULTI, sizeof(ISMULTI));
                                  // convert to upper char  
-                                 if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISMULTI, BUFFER_SIZE) == 1)  
                                      {
-                                        // disable SLEEPMODE 
-                                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                        // send first dummy AT command
-                                        uart_puts_P(AT);
-                                        delay_sec(1); 
-                                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                        delay_sec(1); 
-                                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                        delay_sec(1);
+                                        modemwake();            // disable SLEEPMODE of SIM7000
 
-                                       // send a SMS configrmation of the command
-                                        uart_puts_P(SMS1);
-                                        delay_sec(1); 
-                                        // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                        uart_puts_P(SMS2);
-                                        uart_puts(phonenumber);  // send phone number received from CLIP
-                                        uart_puts_P(CRLF);                                       
-                                        delay_sec(1); 
-                                        uart_puts_P(COMMANDMULTIACK);
-                                       // end the SMS message
-                                        send_uart(26);   // ctrl Z to end SMS
-                                        delay_sec(10); 
+                                       // send a SMS confirmation of the command now
+                                       // or only if there is no fix in a while when acknowledge is combined with position
+                                        ackmsg = COMMANDMULTIACK;
+                                        if (combinedack == 1)  ackpending = 1;
+                                        else                   sendack(ackmsg);
  
                                         // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
                                         uart_puts_P(SMS1);
                                         delay_sec(1); 
-                                        uart_puts_P(DELSMS);
+                                        uart_puts_P(delsms);
                                         delay_sec(2);
 
+                                        // number of positions and interval from SMS "MULTI count interval"
+                                        multicount = smsnumber(ISMULTI, 1, 1, MULTIMAX, conf.multicount);
+                                        multiinterval = smsnumber(ISMULTI, 2, MININTERVAL, MAXINTERVAL, conf.multiinterval);
+
                                         // mark 'initialized' flag to further proceed outside do-while loop
-                                        // send number of GPS polling to 5
+                                        // send number of GPS polling to requested count
                                         initialized = 1; 
                                         ringrcvd = 1;
-                                        continousgps = 5; 
+                                        continousgps = multicount; 
                                      };
 
 
                                  // checking if there is "SINGLE" word in SMS content buffer
-                                 memcpy_P(buf, ISSINGLE, sizeof(ISSINGLE));  
-                                 if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISSINGLE, BUFFER_SIZE) == 1)  
                                      {
-                                        // disable SLEEPMODE 
-                                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                        // send first dummy AT command
-                                        uart_puts_P(AT);
-                                        delay_sec(1); 
-                                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                        delay_sec(1); 
-                                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                        delay_sec(1);
+                                        modemwake();            // disable SLEEPMODE of SIM7000
 
-                                       // send a SMS confirmation of the command
-                                        uart_puts_P(SMS1);
-                                        delay_sec(1); 
-                                        // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                        uart_puts_P(SMS2);
-                                        uart_puts(phonenumber);  // send phone number received from CLIP
-                                        uart_puts_P(CRLF);                                       
-                                        delay_sec(1); 
-                                        uart_puts_P(COMMANDSINGLEACK);
-                                       // end the SMS message
-                                        send_uart(26);   // ctrl Z to end SMS
-                                        delay_sec(10); 
+                                       // send a SMS confirmation of the command now
+                                       // or only if there is no fix in a while when acknowledge is combined with position
+                                        ackmsg = COMMANDSINGLEACK;
+                                        if (combinedack == 1)  ackpending = 1;
+                                        else                   sendack(ackmsg);
  
                                         // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
                                         uart_puts_P(SMS1);
                                         delay_sec(1); 
-                                        uart_puts_P(DELSMS);
+                                        uart_puts_P(delsms);
                                         delay_sec(2);
 
                                         // mark 'initialized' flag to further proceed outside do-while loop
@@ -1241,41 +4864,24 @@ int main(void) {
 
                                    
                                  // checking if there is "ACTIVATE" word in SMS content buffer
-                                 memcpy_P(buf, ISACTIVATE, sizeof(ISACTIVATE));  
-                                 if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISACTIVATE, BUFFER_SIZE) == 1)  
                                      {
-                                        // disable SLEEPMODE 
-                                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                        // send first dummy AT command
-                                        uart_puts_P(AT);
-                                        delay_sec(1); 
-                                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                        delay_sec(1); 
-                                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                        delay_sec(1);
+                                        modemwake();            // disable SLEEPMODE of SIM7000
 
-                                        // write 20 bytes of phonenumber to EEPROM at address EEADDR
+                                        // write 20 bytes of phonenumber to EEPROM at address EEADDR - first entry of whitelist
                                         eeprom_write_block((const void *)phonenumber, (void *)EEADDR, 20);   
+                                        whiteload();
 
                                        // send a SMS confirmation of the command
-                                        uart_puts_P(SMS1);
-                                        delay_sec(1); 
-                                        // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                        uart_puts_P(SMS2);
-                                        uart_puts(phonenumber);  // send phone number received from CLIP
-                                        uart_puts_P(CRLF);                                       
-                                        delay_sec(1); 
-                                        uart_puts_P(ACTIVATED);  // send string Activated calls from...
-                                        uart_puts(phonenumber);  // number copied from SMS sender
-
-                                       // end the SMS message
-                                        send_uart(26);   // ctrl Z to end SMS
-                                        delay_sec(10); 
+                                        smsbegin();
+                                        smsadd_P(ACTIVATED);  // send string Activated calls from...
+                                        smsadd(phonenumber);  // number copied from SMS sender
+                                        smssend(phonenumber);
  
                                         // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
                                         uart_puts_P(SMS1);
                                         delay_sec(1); 
-                                        uart_puts_P(DELSMS);
+                                        uart_puts_P(delsms);
                                         delay_sec(2);
 
                                         // mark 'initialized' flag to further proceed outside do-while loop
@@ -1287,37 +4893,20 @@ int main(void) {
 
 
                                  // checking if there is "GUARD" word in SMS content buffer
-                                 memcpy_P(buf, ISGUARD, sizeof(ISGUARD));  
-                                 if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISGUARD, BUFFER_SIZE) == 1)  
                                     {
-                                        // disable SLEEPMODE 
-                                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                        // send first dummy AT command
-                                        uart_puts_P(AT);
-                                        delay_sec(1); 
-                                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                        delay_sec(1); 
-                                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                        delay_sec(1);
+                                        modemwake();            // disable SLEEPMODE of SIM7000
 
                                        // send a SMS confirmation of the command
-                                        uart_puts_P(SMS1);
-                                        delay_sec(1); 
-                                        // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                        uart_puts_P(SMS2);
-                                        uart_puts(phonenumber);  // send phone number received from CLIP
-                                        uart_puts_P(CRLF);                                       
-                                        delay_sec(1); 
-                                        uart_puts_P(GUARD);  // send string GUARD MODE
+                                        smsbegin();
+                                        smsadd_P(GUARD);  // send string GUARD MODE
  
-                                       // end the SMS message
-                                        send_uart(26);   // ctrl Z to end SMS
-                                        delay_sec(10); 
+                                        smssend(phonenumber);
  
                                         // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
                                         uart_puts_P(SMS1);
                                         delay_sec(1); 
-                                        uart_puts_P(DELSMS);
+                                        uart_puts_P(delsms);
                                         delay_sec(2);
 
                                         // mark 'initialized' flag to further proceed outside do-while loop
@@ -1329,83 +4918,39 @@ int main(void) {
                                         // enable GPS to poll data during GUARD MODE
                                         uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
                                         delay_sec(2);  
-                                        uart_puts_P(GPSCLDSTART);   // cold start of SIM7000 GPS
+                                        gnssrestart();              // cold or warm start of SIM7000 GPS
                                         delay_sec(1);
                                     };  // end of GUARD IF
 
 
                                  // checking if there is "HTTP" word in SMS content buffer
-                                 memcpy_P(buf, ISHTTP, sizeof(ISHTTP));  
-                                 if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISHTTP, BUFFER_SIZE) == 1)  
                                     {
-                                        // disable SLEEPMODE 
-                                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-                                        // send first dummy AT command
-                                        uart_puts_P(AT);
-                                        delay_sec(1); 
-                                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                                        delay_sec(1); 
-                                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-                                        delay_sec(1);
+                                        modemwake();            // disable SLEEPMODE of SIM7000
 
                                        // send a SMS confirmation of the command
-                                        uart_puts_P(SMS1);
-                                        delay_sec(1); 
-                                        // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                        uart_puts_P(SMS2);
-                                        uart_puts(phonenumber);  // send phone number received from CLIP
-                                        uart_puts_P(CRLF);                                       
-                                        delay_sec(1); 
-                                        uart_puts_P(HTTP);  // send string GUARD MODE
+                                        smsbegin();
+                                        smsadd_P(HTTP);  // send string GUARD MODE
  
-                                       // end the SMS message
-                                        send_uart(26);   // ctrl Z to end SMS
-                                        delay_sec(10); 
+                                        smssend(phonenumber);
  
                                         // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
                                         uart_puts_P(SMS1);
                                         delay_sec(1); 
-                                        uart_puts_P(DELSMS);
+                                        uart_puts_P(delsms);
                                         delay_sec(2);
 
                                         // enable GPS to poll data during GUARD MODE
                                         uart_puts_P(GPSPWRON);      // enable SIM7000 GPS power
                                         delay_sec(2);  
-                                        uart_puts_P(GPSCLDSTART);   // cold start of SIM7000 GPS
+                                        gnssrestart();              // cold or warm start of SIM7000 GPS
                                         delay_sec(1);
 										
-										// Internet connectivity initialization procedure
-										attempt = 0;
-										initialized = 0;
-                                        do { 										
-                                            // close the bearer first just in case... maybe there was an error or something
-                                            uart_puts_P(SAPBRCLOSE);
-                                            // provision APN and username for Internet connectivity 
-                                            delay_sec(5);
-                                            uart_puts_P(SAPBR2);
-                                            // only if username password in APN is needed
-                                            delay_sec(1);
-                                            uart_puts_P(SAPBR3);
-                                            delay_sec(1);
-                                            uart_puts_P(SAPBR4);
-                                            //  open IP bearer for communication
-                                            delay_sec(3);
-                                            uart_puts_P(SAPBROPEN);
-                                            // query PDP-bearer context for IP address after several seconds
-                                            // check if bearer was succesfull, do it max 3 times if needed
-                                            initialized = 0; 
-                                            delay_sec(5);
-                                            uart_puts_P(SAPBRQUERY);
-                                            if (readline()>0)
-                                                {
-                                                 // checking for properly attached
-                                                 memcpy_P(buf, SAPBRSUCC, sizeof(SAPBRSUCC));                     
-                                                 if (is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  initialized = 1;
-                                                  // other responses simply ignored as there was no attach
-                                                };
-                                            // increase attempt counter and repeat until not attached
-                                            attempt++;
-                                       } while ( (attempt < 3) && (initialized == 0) );
+                                        // Internet connectivity initialization procedure
+                                        initialized = openbearer();
+
+                                        // interval of posting from SMS "HTTP interval"
+                                        httpinterval = smsnumber(ISHTTP, 1, MININTERVAL, MAXINTERVAL, conf.httpinterval);
 
                                         // mark 'initialized' flag to further proceed outside do-while loop if connected to Internet
                                         // send number of GPS polling to 254 which means this is HTTP MODE
@@ -1415,28 +4960,227 @@ int main(void) {
                                     };  // end of HTTP IF
 
 
+                                 // checking if there is "SCHED" word in SMS content buffer
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISSCHED, BUFFER_SIZE) == 1)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // store new entry in EEPROM if there are parameters, otherwise only list schedule
+                                        schedupdate();
+
+                                       // send a SMS confirmation with whole schedule
+                                        smsbegin();
+                                        smsadd_P(SCHEDULE);
+                                        schedlist(smstext);             // schedule is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command or scheduled report
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of SCHED IF
+
+
+                                 // checking if there is "ALLOW" or "DENY" word in SMS content buffer
+                                 strupr(smstext);
+                                 if   ( (strstr_P(smstext, ISALLOW) != NULL) || (strstr_P(smstext, ISDENY) != NULL) )  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // add or remove number in EEPROM
+                                        whiteupdate();
+
+                                       // send a SMS confirmation with whole whitelist
+                                        smsbegin();
+                                        smsadd_P(WHITELIST);
+                                        whitelist(smstext);             // whitelist is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of ALLOW IF
+
+
+                                 // checking if there is "ACC" word in SMS content buffer
+                                 // this procedure gives CAR BATTERY voltage reading on ADC1 / PC1 port
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISACC, BUFFER_SIZE) == 1)  
+                                    {
+                                        // precise reading in ADC noise reduction sleep while SIM7000 is still sleeping
+                                        carbatterylist(smstext);        // reading is listed to SMS text buffer which is not needed anymore
+
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                       // send a SMS result of ADC measurements of the command
+                                        smsbegin();
+                                        smsadd_P(CARBATTREAD);
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of ACC IF
+
+
+                                 // checking if there is "TTFF" word in SMS content buffer
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISTTFF, BUFFER_SIZE) == 1)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // "TTFF RESET" starts histogram from zero
+                                        if (strstr_P(smstext, ISRESET) != NULL)  memset(&gnsslog, 0, sizeof(gnsslog));
+
+                                       // send a SMS with histogram of every start mode
+                                        smsbegin();
+                                        smsadd_P(TTFF);
+                                        gnsslist(smstext);            // histogram is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+                                        gnsssave();
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of TTFF IF
+
+
+                                 // checking if there is "ENERGY" word in SMS content buffer
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISENERGY, BUFFER_SIZE) == 1)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // "ENERGY RESET" starts accounting from zero
+                                        if (strstr_P(smstext, ISRESET) != NULL)  memset(energytime, 0, sizeof(energytime));
+
+                                       // send a SMS with time and charge of every state
+                                        smsbegin();
+                                        smsadd_P(ENERGY);
+                                        energylist(smstext);            // accounting is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+                                        energysave();
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of ENERGY IF
+
+
+                                 // checking if there is "STATS" word in SMS content buffer
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISSTATS, BUFFER_SIZE) == 1)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // "STATS RESET" starts counting from zero after this listing
+                                        clearafter = (strstr_P(smstext, ISRESET) != NULL);
+                                        statshttp = 1;            // statistics are posted also with next HTTP post
+                                        smsbegin();
+                                        smsadd_P(STATS);
+                                        statslist(smstext);            // statistics are listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+                                        if (clearafter == 1)  statsreset();
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of STATS IF
+
+
+#if ATTRACE
+                                 // checking if there is "TRACE" word in SMS content buffer
+                                 if   (is_in_rx_buffer_P(strupr(smstext), ISTRACE, BUFFER_SIZE) == 1)  
+                                    {
+                                        modemwake();            // disable SLEEPMODE of SIM7000
+
+                                        // "TRACE RESET" clears the ring after this listing
+                                        clearafter = (strstr_P(smstext, ISRESET) != NULL);
+                                        smsbegin();
+                                        smsadd_P(TRACE);
+                                        tracelist(smstext);            // trace is listed to SMS text buffer which is not needed anymore
+                                        smsadd(smstext);
+                                        smssend(phonenumber);
+                                        if (clearafter == 1)  tracecount = 0;
+ 
+                                        // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
+                                        uart_puts_P(SMS1);
+                                        delay_sec(1); 
+                                        uart_puts_P(delsms);
+                                        delay_sec(2);
+
+                                        // go back to sleep and wait for next command
+                                        initialized = 0; 
+                                        ringrcvd = 1;
+                                        continousgps = 0; 
+                                    };  // end of TRACE IF
+#endif
+
+                                 // processed SMS is removed from inbox
+                                 deleteinbox();
+
                             };  // end of ISSMS IF  
 
 
+                    // SMS delivery report - only count it and go back to sleep
+                    if  ( (is_in_rx_buffer_P(response, ISDELIVERY, BUFFER_SIZE) == 1) && (ringrcvd == 0) )  
+                            { 
+                                 readdeliveryreport();
+                                 initialized = 0;
+                                 ringrcvd = 1; 
+                                 continousgps = 0; 
+                            };
+
+
  
                     // if some other message than "RING" or SMS check if network is avaialble and SIM7000 is operational  
                     // maybe power loss or something
                     if  (ringrcvd == 0) 
                       {
-                        // disable SLEEPMODE                  
-                        // first pull LOW DTR pin for AT LEAST 50 miliseconds
-                        PORTC &= ~_BV(PC5);  // Toggle LOW the DTR pin of SIM7000
-
-                        // send first dummy AT command
-                        uart_puts_P(AT);
-                        delay_sec(1); 
-
-                        uart_puts_P(SLEEPOFF);  // switch off to SLEEPMODE = 0
-                        delay_sec(1); 
-
-                        PORTC |= _BV(PC5);   // Toggles again HIGH the DTR pin
-
-                        delay_sec(1);
+                        modemwake();            // disable SLEEPMODE of SIM7000
  
                         // check status of all functions, just in case the SIM7000 restarted itself 
                         checkpin();
@@ -1446,7 +5190,7 @@ int main(void) {
                         // delete all SMSes and SMS confirmation to keep SIM7000 memory empty   
                         uart_puts_P(SMS1);
                         delay_sec(1); 
-                        uart_puts_P(DELSMS);
+                        uart_puts_P(delsms);
                         delay_sec(2);
 
 
@@ -1465,40 +5209,65 @@ int main(void) {
 
                // GPS POLLLING & SMS SENDING LOOP - WE WILL DO AS MANY TIMES AS
                // "gpscontinous" VARIABLE IS SET 
+               // first report starts now, next ones are planned against absolute deadlines of timebase
+        nextreport = getuptime();
+        packsms_pos = 0;
+
+               // SMS arriving during the session are stored and only STOP is taken from inbox by waitevent,
+               // other commands are processed when the session ends - also in direct mode
+        if (smsinbox == 0)
+           {
+            uart_puts_P(SHOWSMSINBOX);
+            delay_sec(1);
+           };
          
         do  {
                    
-               // clear the 'initialized' and 'gpsdataavailable' flags 
+               // clear the 'initialized', 'gpsdataavailable' and 'estimated' flags 
                initialized = 0;
                gpsdataavailable = 0; 
+               estimated = 0;
 
                // call polling from GPS SIM7000, if it was successful mark it by flag 'gpsdataavailable'
 
-               if (readgpsinfo()==1)
+               gpsresult = readgpsinfo();
+               if (gpsresult > 0)
                   { 
-                   // mark flag that GPS data are available 
+                   // mark flag that GPS data are available ( new or cached fix )
                    gpsdataavailable = 1; 
 
                    // THERE IS NO NEED TO CONVERT ANY GPS DATA FROM SIM7000 AS IT WAS FOR SIM808 MODULE !
-                   // WE SIMPLY COPY LATITUDE & LONGITUDE TO TEXT MESSAGE DIRECTLY 
+                   // LATITUDE, LONGITUDE AND TIME ARE PARSED TO 'fix' AND USED BY TEXT MESSAGE DIRECTLY 
                    // the longtitude is written as [-180.000000,180.000000] - 11 characters
                    // the latitude is written as [-90.000000,90.000000] - 10 characters
-   
 
-                       // copy longtitude for text message
-                       memcpy(longtitudegps, longtitude, 11);
-                       longtitudegps[11] = 0x00;
-                       // put NULL at the end
-                                               
-                       // copy latitude for text message
-                       memcpy(latitudegps, latitude, 10);  
-                       latitudegps[10] = 0x00;
-
-                        // copy GPS time for text or HTTP message
-                       memcpy(utctimegps, utctime, 14);  
-                       utctimegps[14] = 0x00;
+                       // cached fix was already used to discipline RTC and for dead reckoning
+                       if (gpsresult == 1)
+                         {
+                         // discipline SOFT RTC with GNSS time on every fix
+                         rtcsyncgnss(fix.utctime);
+
+                         // remember this fix for dead reckoning during next GNSS outage
+                         lastfixlat = microdegrees(fix.latitude);
+                         lastfixlong = microdegrees(fix.longtitude);
+                         lastfixspeed = microdegrees(fix.speed) / 100000L;
+                         lastfixcourse = microdegrees(fix.course) / 1000000L;
+                         lastfixtime = getuptime();
+                         };
                  
-                   };  // END OF GPSINFO IF
+                   }  // END OF GPSINFO IF
+               else
+                   {
+                   // no GNSS fix ( tunnel, parking structure ) - outside GUARD MODE project last good fix
+                   // so the track stays continous, such position is flagged as estimated in the report
+                   if ( (continousgps != 255) && (deadreckoning() == 1) )
+                      {
+                       gpsdataavailable = 1;
+                       estimated = 1;
+                       // estimated position gets current time from SOFT RTC instead of last fix time
+                       if (rtcsource != 0) rtcformat(fix.utctime);
+                      };
+                   };
 
 
 
@@ -1507,53 +5276,77 @@ int main(void) {
                  // then proceed with sending SMS                   
                  // avoid sending SMS with no usable information
  
+                // check battery voltage and select power profile for next cycle
+                   powercheck();
+
                 if (  (  ( gpsdataavailable == 1) ) && (continousgps != 255) && (continousgps != 254)  )
                    {
-                          // check battery voltage
-                          delay_sec(1);
-                          uart_puts_P(CHECKBATT);
-                          readbattery();
-
-                          // send a SMS in plain text format
-                          delay_sec(1); 
-                          uart_puts_P(SMS1);
-                          delay_sec(1); 
-                          // compose an SMS from fragments - interactive mode CTRL Z at the end
-                          uart_puts_P(SMS2);
-                          uart_puts(phonenumber);        // send phone number received from SMS
-                          uart_puts_P(CRLF);                                       
+                          // scheduled report is delivered at scheduled minute, not earlier - STOP, alarm input
+                          // and car battery are served meanwhile
+                          while ( (scheddue != 0) && (rtcnow() < scheddue) && (waitevent(scheddue - rtcnow()) != 1) );
+                          scheddue = 0;
+
+
+                          // combined acknowledge - MULTI positions after the first one are packed into one SMS
+                          if ( (combinedack == 1) && (ackpending == 0) && ((continousgps > 1) || (packsms_pos > 0)) )
+                             {
+                               packposition();
+                             }
+                          else
+                             {
+                          ackpending = 0;        // this position is acknowledge of the command too
+
+                          // compose an SMS from fragments - sent in text or PDU mode
                           delay_sec(1); 
+                          smsbegin();
                           // send LONGTITUDE
-                          uart_puts_P(LONG);                      // send longtitude string
-                          uart_puts(longtitudegps);               // send REAL GPS info about LAONGTITUDE
+                          smsadd_P(LONG);                         // send longtitude string
+                          smsadd(fix.longtitude);                  // send REAL GPS info about LAONGTITUDE
                           // send LATTITUDE
-                          uart_puts_P(LATT);                      // send lattitude string
-                          uart_puts(latitudegps);                 // send REAL GPS info about LATTITUDE
+                          smsadd_P(LATT);                         // send lattitude string
+                          smsadd(fix.latitude);                    // send REAL GPS info about LATTITUDE
                           // put battery info
-                          uart_puts_P(BATT);                      // send BATTERY VOLTAGE in milivolts
-                          uart_puts(battery);                     // from buffer
+                          smsadd_P(BATT);                         // send BATTERY VOLTAGE in milivolts
+                          smsadd(battery);                        // from buffer
                           // put GPS time information
-                          uart_puts_P(GPSTIME);                      // send BATTERY VOLTAGE in milivolts
-                          uart_puts(utctimegps);                     // from buffer
-						  
-                          // put link to GOOGLE MAPS
-                          uart_puts_P(GOOGLELOC1);                // send http ****
-                          uart_puts(latitudegps);                 // send REAL GPS info about LATTITUDE
-                          uart_puts_P(GOOGLELOC2);                // send comma
-                          uart_puts(longtitude);                  // send Google API LONGTITUDE;
-                          uart_puts_P(GOOGLELOC3);                // send CRLF
-                          delay_sec(1); 
-                          // end the SMS message
-                          send_uart(26);                          // ctrl Z to end SMS and send it over the air
+                          smsadd_P(GPSTIME);                      // send GPS time
+                          smsadd(fix.utctime);                     // from buffer
+                          // mark position projected from last fix
+                          if (estimated == 1) smsadd_P(ESTIMATED);
+
+                          // put short location link or link to GOOGLE MAPS
+                          if (shortloc == 1)
+                             {
+                              geohashencode();
+                              smsadd_P(SHORTLOC1);                // send short base URL
+                              smsadd(geohash);                    // send geohash of the position
+                             }
+                          else
+                             {
+                              smsadd_P(GOOGLELOC1);               // send http ****
+                              smsadd(fix.latitude);                // send REAL GPS info about LATTITUDE
+                              smsadd_P(GOOGLELOC2);               // send comma
+                              smsadd(fix.longtitude);              // send REAL GPS info about LONGTITUDE
+                             };
+                          smsadd_P(GOOGLELOC3);                   // send CRLF
+                          // send it over the air
+                          smssend(phonenumber);
+                             };
 
                    };   // end of IF for gpsavailable available
+
+                 // send packed MULTI positions after last cycle or when next position would not fit
+                if (  (packsms_pos > 0) && ( (continousgps == 1) || (packsms_pos + PACKLINE > packlimit()) )  )
+                   {
+                          sendpacked();
+                   };
                  
 
 
                     // Checking if this is first pass of guard and there is any previous GPS position
                     // if first GPS checking then previous position is '0'
-                         latdiff = atof(latitudegpsold);
-                         longdiff = atof(longtitudegpsold);
+                         latdiff = guardlat;
+                         longdiff = guardlong;
 
 
                  // if CELL GPS data available or real SIM7000 GPS data available and GUARD MODE enabled
@@ -1562,8 +5355,8 @@ int main(void) {
                 if (  ( gpsdataavailable == 1) && (continousgps == 255) && (latdiff != 0) && (longdiff !=0) )
                    {
                     // Now comparing numbers of Latitude and Longtitude to calculate position difference
-                         latdiff = atof(latitudegpsold) - atof(latitudegps);
-                         longdiff = atof(longtitudegpsold) - atof(longtitudegps);
+                         latdiff = guardlat - microdegrees(fix.latitude);
+                         longdiff = guardlong - microdegrees(fix.longtitude);
 
  
                      // if necessary get rid of 'minus' sign no to get false positives
@@ -1571,41 +5364,41 @@ int main(void) {
                      if (longdiff < 0)  longdiff = 0 - longdiff;
 
                     // if difference greater than 3 hundread of meters... this value can be modified for SENSIVITY
-                    if ( ( longdiff > 0.0027 )  ||  ( latdiff > 0.0027 ) ) 
+                    // one meter is ~9 microdegrees ( 1 / 111000 degree )
+                    if ( ( longdiff > conf.guard * 9009L / 1000 )  ||  ( latdiff > conf.guard * 9009L / 1000 ) ) 
                           // if GPS movement detected send ALERT
                         {
-                          // send a SMS in plain text format
-                          delay_sec(1); 
-                          uart_puts_P(SMS1);
+                          // compose an SMS from fragments - sent in text or PDU mode
                           delay_sec(1); 
-                          // compose an SMS from fragments - interactive mode CTRL Z at the end
-                          uart_puts_P(SMS2);
-                          uart_puts(phonenumber);  // send phone number received from CLIP
-                          uart_puts_P(CRLF);                                       
-                          delay_sec(1); 
-
-                          uart_puts_P(ALERT);                                  // send ALERT info
-
-                          // put link to GOOGLE MAPS
-                          uart_puts_P(GOOGLELOC1);                            // send http ****
-                          uart_puts(latitudegps);                             // send REAL GPS info about LATITUDE
-                          uart_puts_P(GOOGLELOC2);                            // send comma
-                          uart_puts(longtitudegps);                           // send REAL GPS info about LONGTITUDE
-                          uart_puts_P(GOOGLELOC3);                            // send CRLF
-                          delay_sec(1); 
-                          // end the SMS message
-                          send_uart(26);                                      // ctrl Z to end SMS and send it over the air
+                          smsbegin();
+                          smsadd_P(ALERT);                                     // send ALERT info
+
+                          // put short location link or link to GOOGLE MAPS
+                          if (shortloc == 1)
+                             {
+                              geohashencode();
+                              smsadd_P(SHORTLOC1);                            // send short base URL
+                              smsadd(geohash);                                // send geohash of the position
+                             }
+                          else
+                             {
+                              smsadd_P(GOOGLELOC1);                           // send http ****
+                              smsadd(fix.latitude);                            // send REAL GPS info about LATITUDE
+                              smsadd_P(GOOGLELOC2);                           // send comma
+                              smsadd(fix.longtitude);                          // send REAL GPS info about LONGTITUDE
+                             };
+                          smsadd_P(GOOGLELOC3);                               // send CRLF
+                          smssend(phonenumber);
 
                         // clear continousgps flag by setting to 1 - get out of GUARD MODE
-                          delay_sec(10);
                           continousgps = 1;      
                         // disable GPS to conserve power after quitting GUARD MODE
                           uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS after quiting GUARD MODE
                           delay_sec(1);  
-                        // delete all SMSes and SMS confirmation to keep SIM7000 memory empty   
+                        // delete read SMSes and SMS confirmation - commands stored during the session are kept
                           uart_puts_P(SMS1);
                           delay_sec(1); 
-                          uart_puts_P(DELSMS);
+                          uart_puts_P(DELSMSREAD);
                           delay_sec(2);
                        };  // end of IF 
  
@@ -1627,125 +5420,72 @@ int main(void) {
 					
 					// begin sending to your HTTP server 
                     uart_puts_P(HTTPURL1);
-                    uart_puts_P(HTTPURL2);
+                    confputs(offsetof(struct confblock, url));       // exact url of your HTTP server from configuration
                     // put LONGTITUDE field now to HTTP GET params
                     uart_puts_P(HTTPURL3);
-					uart_puts(longtitudegps); 
+					uart_puts(fix.longtitude); 
                     // put LATITUDE field now to HTTP GET params
                     uart_puts_P(HTTPURL4);
-					uart_puts(latitudegps); 	
+					uart_puts(fix.latitude); 	
                     // put TIME field now to HTTP GET params
                     uart_puts_P(HTTPURL5);
-					uart_puts(utctimegps); 	
+					uart_puts(fix.utctime); 	
+                    // mark position projected from last fix
+                    if (estimated == 1) uart_puts_P(HTTPURL7);
+                    // put CAR BATTERY voltage and its last alert
+                    uart_puts_P(HTTPURL8);
+                    uart_putu(carbattery(adclast, 12));
+                    if (carbatthttp == 1)
+                       {
+                        uart_puts_P(HTTPURL9);
+                        send_uart('0' + carbattstate);
+                        carbatthttp = 0;
+                       };
+                    // put estimated charge used
+                    uart_puts_P(HTTPURL10);
+                    uart_putu(energytotal());
+                    // put statistics once after STATS command
+                    if (statshttp == 1)
+                       {
+                        uart_puts_P(HTTPURL11);
+                        statsputs();
+                        statshttp = 0;
+                       };
                     // send HTTP end sequence and make HTTP action
                     uart_puts_P(HTTPURL6);  // put CRLF at the end
                     delay_sec(2); 
                     uart_puts_P(HTTPACTION);  // send prepared HTTP POST
-                    delay_sec(10);            // more seconds needed for stable TCP connection
+                    httpresult(10);           // wait for HTTP status of stable TCP connection, counted in statistics
 			
                   }; // end of IF for continous GPS = 254
 
 
                 // copy current GPS position as old GPS position for comparision during GUARD mode
-                   memcpy(latitudegpsold, latitudegps, 10);  
-                   memcpy(longtitudegpsold, longtitudegps, 11);  
-                   longtitudegpsold[11] = 0x00;
-                   latitudegpsold[10] = 0x00;
+                   guardlat = microdegrees(fix.latitude);
+                   guardlong = microdegrees(fix.longtitude);
 
 
                 // decrease continousgps attempt number, this is global variable also checked in GPS procedures
-                   if ( ( continousgps != 255) && ( continousgps != 254) ) continousgps-- ;
-
-                // wait ten seconds or longer (if continous mode)
-                // just in case SMS confirmation was received not to trigger anything
-                   if ( (continousgps > 0) && (continousgps<254) )
+                // STOP received during this cycle ends MULTI, GUARD or HTTP mode
+                   if (stoprequest == 1)  stopreport();
+                   else if ( ( continousgps != 255) && ( continousgps != 254) ) continousgps-- ;
+
+                // plan deadline of next report - time already spent in this cycle is subtracted
+                   if ( continousgps == 255 )       plannext(conf.guardinterval);
+                   else if ( continousgps == 254 )  plannext(httpinterval);
+                   else                             plannext(multiinterval);
+
+                // wait until next deadline (if continous mode) - SMS and voice calls are checked while waiting
+                // so STOP command ends MULTI, GUARD or HTTP MODE at once
+                   if (continousgps > 0)
                         {                            
-                          // if in GPS continous mode delay XX minutes before next attempt
-                          delay_sec(60);
-                          delay_sec(60);
-                          delay_sec(60);
+                          while ( (getuptime() < nextreport) && (waitevent(nextreport - getuptime()) != 1) );
+                          if (stoprequest == 1)  stopreport();
                          };
 			
                 // if ending sequence of GPS checking simply wait until SMS is delivered
                    if ( continousgps == 0)   delay_sec(10);  
 
-
-                // if GUARD or HTTP MODE is active check if incoming STOP text message...
-                   if ( ( continousgps == 255) || ( continousgps == 254) )     
-                          {   // wait 1 minute for SMS to stop GUARD or HTTP MODE
-
-                                delay_sec(1);    // delay to empty serial buff
-            					   // first empty serial buffer - read all unnecessary chars
-                                while (UCSR0A & (1<<RXC0)) char1 = UDR0; 
-
-                                nbr50useconds = 0UL;           // clear time counter first
-                                initialized = 0;               // flag for something on serial port
-
-                                 // wait until something received from serial port or 1 minute passed
-                                do 
-                                    {
-                                     nbr50useconds++;               // increase number of 50useconds waited
-                                     delay_50usec();                // wait another 50usec
-                                     if ( UCSR0A & (1<<RXC0))          initialized = 1;     // if something on serial port quit waiting
-                                     if ( nbr50useconds == 800000UL )  initialized = 2;     // if ~60 sec reached
-                                    }  while ( initialized == 0);   // end of WHILE for SMS and delaying 1 sec
-
-
-                                if ( initialized == 1 )      // if something on serial port we need to check it
-                                   {  
-                                      initialized = 0;       // clear serial port  flag 
-                                     if (readline()>0)       // there is something on serial port...
-                                      {
-                                         // check if this is an SMS message first
-                                          memcpy_P(buf, ISSMS, sizeof(ISSMS));  
-                                          if  ( is_in_rx_buffer(response, buf, BUFFER_SIZE) == 1)  
-                                              { 
-                                              // extract TXT SMS content first not to lose incoming serial port characters... timing issue...
-                                              readsmstxt();
-                                              // then we need to extract phone number from SMS message RESPONSE buffer
-                                              readsmsphonenumber(); 
-
-                                              // checking if there is "STOP" word in SMS content buffer
-                                              memcpy_P(buf, ISSTOP, sizeof(ISSTOP));
-                                              // convert to upper char  
-                                              if   (is_in_rx_buffer(strupr(smstext), buf, BUFFER_SIZE) == 1)  
-                                                   {
-                                                    // send a SMS configrmation of the command
-                                                    uart_puts_P(SMS1);
-                                                    delay_sec(1); 
-                                                    // compose an SMS from fragments - interactive mode CTRL Z at the end
-                                                    uart_puts_P(SMS2);
-                                                    uart_puts(phonenumber);  // send phone number received from CLIP
-                                                    uart_puts_P(CRLF);                                       
-                                                    delay_sec(1); 
-                                                    uart_puts_P(STOP);
-                                                    // end the SMS message
-                                                    send_uart(26);   // ctrl Z to end SMS
-                                                    delay_sec(10); 
-                                                    // delete all previous SMSes and SMS confirmation to keep SIM7000 memory empty   
-                                                    uart_puts_P(SMS1);
-                                                    delay_sec(1); 
-                                                    uart_puts_P(DELSMS);
-                                                    delay_sec(2);
-                                                    // disable GPS to conserve power after quitting GUARD MODE
-                                                    uart_puts_P(GPSPWROFF);  // disable SIM7000 GPS after quiting GUARD or HTTP MODE
-                                                    delay_sec(1);   
-                                                    // send number of GPS polling to 1 to disable GUARD MODE
-                                                    continousgps = 0; 
-                                                    //and close the IP bearer for Internet connectivity 
-                                                    uart_puts_P(SAPBRCLOSE);
-                                                    delay_sec(5);
-													
-									                };  // end of STOP IF
-
-                                               }; // end of IS SMS IF
- 
-                                         }; // END of READLINEIF
-
-                                    };  // END of IF INITIALIZED
-
-                    };  // end of IF CONTINOUSGPS
-
                           
  
         // END OF CONTINOUS GPS LOOP